@@ -3,50 +3,194 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <obelisk/db.h>
+
+// Forward declarations
+typedef struct ObeliskNodeAllocator ObeliskNodeAllocator;
+typedef struct ObeliskLearnedIndex ObeliskLearnedIndex;
 
 // B-tree node types
 typedef enum {
     OBELISK_NODE_LEAF = 0,
-    OBELISK_NODE_INTERNAL = 1
+    OBELISK_NODE_INTERNAL = 1,
+    OBELISK_NODE_BUFFERED = 2   // Internal node with a message buffer (buffered trees)
 } ObeliskNodeType;
 
-// B-tree order (maximum number of children per node)
-#define OBELISK_BTREE_ORDER 128
+// Node layouts. Leaf and internal nodes each fill one OBELISK_PAGE_SIZE page:
+// a cache-line header followed directly by the key array, so a key search
+// never shares cache lines with the cold metadata. Fanout follows from the
+// page size at compile time.
+#define OBELISK_BTREE_NODE_HEADER_SIZE 64
+
+// B-tree order (maximum number of children per internal node)
+#define OBELISK_BTREE_ORDER \
+    ((OBELISK_PAGE_SIZE - OBELISK_BTREE_NODE_HEADER_SIZE + sizeof(uint64_t)) / (2 * sizeof(uint64_t)))
+
+// Maximum number of key/value pairs per leaf
+#define OBELISK_BTREE_LEAF_CAPACITY \
+    ((OBELISK_PAGE_SIZE - OBELISK_BTREE_NODE_HEADER_SIZE) / (2 * sizeof(uint64_t)))
+
+// Buffered internal nodes trade fanout for a message buffer: a small pivot
+// array up front and the rest of the page holding pending operations
+#define OBELISK_BTREE_BUFFERED_FANOUT 32
 
-// B-tree node structure
+// Maximum number of pending messages per buffered node
+#define OBELISK_BTREE_BUFFER_CAPACITY \
+    ((OBELISK_PAGE_SIZE - OBELISK_BTREE_NODE_HEADER_SIZE - \
+      (2 * OBELISK_BTREE_BUFFERED_FANOUT - 1) * sizeof(uint64_t) - sizeof(uint32_t)) / \
+     (2 * sizeof(uint64_t) + sizeof(uint8_t)))
+
+// B-tree node header, shared by both layouts
 typedef struct ObeliskNode {
+    _Alignas(OBELISK_BTREE_NODE_HEADER_SIZE)
+    uint64_t version;  // Optimistic latch: bit 0 obsolete, bit 1 locked, upper bits count writes
     ObeliskNodeType type;
     uint32_t num_keys;
-    uint64_t keys[OBELISK_BTREE_ORDER - 1];
-    uint64_t children[OBELISK_BTREE_ORDER];
-    struct ObeliskNode* parent;
-    bool is_dirty;
+
+    // Cold metadata
     uint64_t page_id;
+    uint64_t next_leaf;  // Leaf sibling links for range scans, as node references
+    uint64_t prev_leaf;
+    struct ObeliskNode* parent;  // Node holding a swizzled reference to this one, if any
+    uint64_t epoch;              // Tree epoch of the last operation to reach the node
+    bool is_dirty;
 } ObeliskNode;
 
+// Internal node: separator keys and child node references
+typedef struct {
+    ObeliskNode header;
+    uint64_t keys[OBELISK_BTREE_ORDER - 1];
+    uint64_t children[OBELISK_BTREE_ORDER];
+} ObeliskInternalNode;
+
+// Leaf node: sorted keys and their values
+typedef struct {
+    ObeliskNode header;
+    uint64_t keys[OBELISK_BTREE_LEAF_CAPACITY];
+    uint64_t values[OBELISK_BTREE_LEAF_CAPACITY];
+} ObeliskLeafNode;
+
+// Buffered internal node: pivots, children and a key-sorted buffer of
+// insert/delete messages not yet applied to the subtree below
+typedef struct {
+    ObeliskNode header;
+    uint64_t keys[OBELISK_BTREE_BUFFERED_FANOUT - 1];
+    uint64_t children[OBELISK_BTREE_BUFFERED_FANOUT];
+    uint64_t msg_keys[OBELISK_BTREE_BUFFER_CAPACITY];
+    uint64_t msg_values[OBELISK_BTREE_BUFFER_CAPACITY];
+    uint32_t num_msgs;
+    uint8_t msg_ops[OBELISK_BTREE_BUFFER_CAPACITY];
+} ObeliskBufferedNode;
+
 // B-tree structure
 typedef struct {
     ObeliskNode* root;
     uint64_t num_nodes;
     uint64_t height;
     void* page_manager;  // Opaque pointer to page manager
+    bool concurrent;     // Nodes are latched with optimistic lock coupling
+    double merge_threshold;  // Occupancy below which deletes rebalance a node
+    bool buffered;           // Internal nodes buffer updates (write-optimized)
+    uint64_t pending_messages;  // Messages held in buffers across the tree
+    uint64_t smo_count;         // Bumped by every split, merge and root change
+    uint32_t learned_error_bound;     // Build a learned index after bulk load (0 = never)
+    ObeliskLearnedIndex* learned;     // Learned leaf index, valid while smo_count is unchanged
+    ObeliskNodeAllocator* allocator;  // Slab/free-list node memory
+    bool evictable;                   // Nodes other than the root may be evicted from the pool
+    uint64_t epoch;                   // Nodes stamped with it are in use by the current operation
 } ObeliskBTree;
 
+// B-tree configuration
+typedef struct {
+    void* page_manager;  // ObeliskBufferPool* holding the nodes, or NULL for heap nodes
+    bool concurrent;     // Allow search/insert/delete from multiple threads
+    double merge_threshold;  // Fraction of capacity in [0, 0.5]; 0 defers all merging to btree_compact
+    bool buffered;           // Write-optimized mode; cannot be combined with concurrent
+    uint32_t learned_error_bound;  // Error bound, in leaves, of the index built by btree_bulk_load (0 = none);
+                                   // cannot be combined with concurrent or buffered
+} ObeliskBTreeConfig;
+
+// Occupancy threshold used by btree_create
+#define OBELISK_BTREE_DEFAULT_MERGE_THRESHOLD 0.25
+
 // B-tree operations
+// page_manager is an ObeliskBufferPool* whose frames hold the nodes, or NULL
+// for heap-allocated nodes. Buffer pool pages must be at least
+// OBELISK_PAGE_SIZE bytes.
+//
+// Over a pool, only the root of a non-concurrent tree stays pinned, so the
+// tree can outgrow the pool. A child reference holds the child's address
+// while it is resident and its page id otherwise; descents follow addresses
+// without consulting the pool, and the pool asks the tree to swap the
+// address back for the page id before evicting a node. Such a tree must be
+// used, together with its pool, from one thread at a time, and a node
+// returned by btree_find_leaf stays valid only until the next call into
+// either. Only one tree per pool works this way; any other, and every
+// concurrent tree, keeps all its nodes pinned.
+//
+// In concurrent mode btree_search, btree_insert and btree_delete may run from
+// any number of threads: readers take no latches and restart when a node's
+// version changes underneath them, writers latch only the nodes they modify.
+// All other operations still need exclusive access to the tree.
+//
+// In buffered mode inserts and deletes become messages queued in the root's
+// buffer and are pushed down a level at a time, in batches, whenever a buffer
+// fills, so each leaf write absorbs many updates. Lookups check the buffers on
+// the way down. Deletes are blind: btree_delete succeeds whether or not the
+// key exists. btree_find_leaf and the iterator flush every pending message to
+// the leaves first.
 ObeliskBTree* btree_create(void* page_manager);
+ObeliskBTree* btree_create_with_config(const ObeliskBTreeConfig* config);
 void btree_destroy(ObeliskBTree* tree);
+size_t btree_get_memory_usage(ObeliskBTree* tree);
+
+// Bulk loading: build an empty tree bottom-up from strictly ascending keys.
+// next() returns false once the input is exhausted; fill_factor in (0, 1]
+// sets how full each node is packed.
+typedef bool (*ObeliskBTreeLoadFn)(void* ctx, uint64_t* key, uint64_t* value);
+int btree_bulk_load(ObeliskBTree* tree, ObeliskBTreeLoadFn next, void* ctx, double fill_factor);
 
 // Search operations
 bool btree_search(ObeliskBTree* tree, uint64_t key, uint64_t* value);
 ObeliskNode* btree_find_leaf(ObeliskBTree* tree, uint64_t key);
 
+// Learned leaf index for read-mostly trees: piecewise-linear segments map a
+// key to its leaf's position within error_bound leaves, so btree_find_leaf
+// becomes one model evaluation and a short bounded search instead of a
+// descent through the upper levels. Any split or merge, or the eviction of
+// a leaf, retires the model and lookups fall back to the normal descent
+// until it is rebuilt. Not available for concurrent or buffered trees.
+int btree_build_learned_index(ObeliskBTree* tree, uint32_t error_bound);
+void btree_drop_learned_index(ObeliskBTree* tree);
+
+// Look up n keys at once. Lookups advance through the tree level by level in
+// small groups, prefetching each one's next node while the others search.
+// values[i] and found[i] (either may be NULL) receive the result for keys[i];
+// returns the number of keys found, or OBELISK_BTREE_BATCH_ERROR if a node
+// could not be read from the pool, in which case found[i] is false for the
+// keys it hid as well as the absent ones. btree_search cannot tell the two
+// apart and returns false for both.
+#define OBELISK_BTREE_BATCH_ERROR SIZE_MAX
+size_t btree_search_batch(ObeliskBTree* tree, const uint64_t* keys, size_t n,
+                          uint64_t* values, bool* found);
+
 // Insertion operations
 int btree_insert(ObeliskBTree* tree, uint64_t key, uint64_t value);
-int btree_split_child(ObeliskNode* parent, int index, ObeliskNode* child);
+int btree_split_child(ObeliskBTree* tree, ObeliskNode* parent, int index, ObeliskNode* child);
 
 // Deletion operations
+// A delete only rebalances a node once it falls below merge_threshold of its
+// capacity, so a workload hovering around a node boundary does not split and
+// merge the same nodes back and forth. An underfull node is merged with a
+// neighbour when the two fit comfortably in one node and otherwise borrows
+// entries from it. Concurrent deletes never restructure the tree.
 int btree_delete(ObeliskBTree* tree, uint64_t key);
-int btree_merge_nodes(ObeliskNode* left, ObeliskNode* right);
+int btree_merge_nodes(ObeliskBTree* tree, ObeliskNode* parent, int index);
+
+// Rebalance every node left below half occupancy by deferred or concurrent
+// deletes and shrink the tree height where possible
+int btree_compact(ObeliskBTree* tree);
 
 // Utility operations
 void btree_print(ObeliskBTree* tree);
@@ -60,6 +204,7 @@ typedef struct {
 } ObeliskBTreeIterator;
 
 ObeliskBTreeIterator* btree_iterator_create(ObeliskBTree* tree);
+bool btree_iterator_seek(ObeliskBTreeIterator* iter, uint64_t key);  // Position at first key >= key
 bool btree_iterator_next(ObeliskBTreeIterator* iter, uint64_t* key, uint64_t* value);
 void btree_iterator_destroy(ObeliskBTreeIterator* iter);
 
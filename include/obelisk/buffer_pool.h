@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // Forward declarations
 typedef struct ObeliskBufferPool ObeliskBufferPool;
@@ -14,51 +15,157 @@ typedef enum {
     OBELISK_PAGE_DIRTY = 1
 } ObeliskPageState;
 
+// What a page holds, for hit and miss accounting only
+typedef enum {
+    OBELISK_PAGE_CLASS_OTHER = 0,   // Untagged
+    OBELISK_PAGE_CLASS_INDEX,
+    OBELISK_PAGE_CLASS_HEAP,
+    OBELISK_PAGE_CLASS_OVERFLOW,
+    OBELISK_PAGE_CLASS_COUNT
+} ObeliskPageClass;
+
 // Page structure
 struct ObeliskPage {
     uint64_t page_id;
     void* data;
     ObeliskPageState state;
-    uint32_t pin_count;
+    uint32_t pin_count;         // Updated atomically
     uint64_t last_accessed;
+    bool is_valid;  // Frame holds page_id; false for empty frames
+    uint32_t frame;             // Slot within the pool, for its own bookkeeping
+    bool swizzled;              // Reached by direct pointer; see buffer_pool_set_eviction_callback
+    ObeliskPageClass page_class;  // Kept while resident; the holder of a pin may set it
 };
 
 // Buffer pool configuration
 typedef struct {
     size_t pool_size;           // Number of pages in pool
     size_t page_size;           // Size of each page in bytes
-    const char* data_file;      // Path to data file
-    bool use_direct_io;         // Use O_DIRECT for I/O
+    const char* data_file;      // Path to data file, or NULL for a memory-only pool
+    bool use_direct_io;         // Use O_DIRECT for I/O (falls back to buffered I/O if refused)
     size_t prefetch_size;       // Number of pages to prefetch
+    size_t num_shards;          // Independently latched partitions; 0 picks one per CPU
+    double clean_target;        // Share of frames the background cleaner keeps clean, in [0, 1); 0 picks the default
+    bool use_huge_pages;        // Back frames with 2 MB huge pages (falls back to normal pages if unavailable)
+    bool numa_aware;            // Place each shard's frames on one NUMA node, spreading shards across nodes
+    const char* manifest_file;  // Hot page list for warm restarts, or NULL; needs a data file
+    uint32_t manifest_interval_ms;  // Also save the list this often while running; 0 saves it only on destroy
 } ObeliskBufferPoolConfig;
 
+#define OBELISK_BUFFER_POOL_DEFAULT_CLEAN_TARGET 0.2
+
 // Buffer pool operations
 ObeliskBufferPool* buffer_pool_create(const ObeliskBufferPoolConfig* config);
 void buffer_pool_destroy(ObeliskBufferPool* pool);
 
-// Page operations
+// Page operations. Every call is thread-safe. A page returned by get_page
+// is not pinned and may be evicted by another thread at any time; threads
+// sharing a pool should use fetch_page, which returns it pinned.
 ObeliskPage* buffer_pool_get_page(ObeliskBufferPool* pool, uint64_t page_id);
+ObeliskPage* buffer_pool_fetch_page(ObeliskBufferPool* pool, uint64_t page_id);
 int buffer_pool_pin_page(ObeliskBufferPool* pool, uint64_t page_id);
 int buffer_pool_unpin_page(ObeliskBufferPool* pool, uint64_t page_id, bool is_dirty);
 int buffer_pool_flush_page(ObeliskBufferPool* pool, uint64_t page_id);
 
+// fetch_page that counts the hit or miss under page_class and tags the page
+// with it. Untagged calls count under the class the page already has.
+ObeliskPage* buffer_pool_fetch_page_class(ObeliskBufferPool* pool, uint64_t page_id,
+                                          ObeliskPageClass page_class);
+
+// Pages an owner reaches by direct pointer, as a B-tree does when it links
+// resident nodes by address ("pointer swizzling"), are released with
+// unpin_swizzled instead of unpin_page. The owner's callback is consulted
+// before such a page is evicted: with evicting false it only answers whether
+// the page may go; with evicting true the page is going, and the owner must
+// drop every pointer to it and return true if it holds changes the pool has
+// to write back first. The callback runs with a pool latch held and must not
+// call into the pool. A pool has one owner at a time: setting a callback
+// fails while another is installed, and clearing it (fn NULL) turns every
+// swizzled page back into an ordinary one.
+typedef bool (*ObeliskEvictionFn)(void* ctx, ObeliskPage* page, bool evicting);
+int buffer_pool_set_eviction_callback(ObeliskBufferPool* pool, ObeliskEvictionFn fn, void* ctx);
+int buffer_pool_unpin_swizzled(ObeliskBufferPool* pool, uint64_t page_id, bool is_dirty);
+
+// Page allocation (new pages are returned pinned and zeroed; page ids start at 1)
+ObeliskPage* buffer_pool_new_page(ObeliskBufferPool* pool, uint64_t* page_id);
+int buffer_pool_delete_page(ObeliskBufferPool* pool, uint64_t page_id);
+size_t buffer_pool_get_page_size(ObeliskBufferPool* pool);
+
 // Bulk operations
 int buffer_pool_flush_all(ObeliskBufferPool* pool);
 int buffer_pool_prefetch_pages(ObeliskBufferPool* pool, uint64_t* page_ids, size_t count);
 
+// Warm restart. A pool with a manifest_file saves the ids of its resident
+// pages there, hottest first, on destroy and every manifest_interval_ms. A
+// new pool finds the list on create and reads those pages back in the
+// background, in page order and only into frames nothing else has claimed,
+// while it serves requests. save_manifest saves the list right away.
+int buffer_pool_save_manifest(ObeliskBufferPool* pool);
+
 // Statistics and monitoring
 typedef struct {
     uint64_t hits;              // Buffer pool hits
     uint64_t misses;            // Buffer pool misses
     uint64_t evictions;         // Number of pages evicted
     uint64_t flushes;          // Number of pages flushed to disk
-    double hit_ratio;          // Hit ratio (hits / (hits + misses))
+    double hit_ratio;          // Hit ratio (hits / (hits + misses)), 0 before any access
+    uint64_t cleaner_pages;     // Pages written by the background cleaner
+    uint64_t cleaner_writes;    // Vectored writes the cleaner issued for them
+    uint64_t foreground_writebacks;  // Dirty victims a reader had to write itself
+    uint64_t dirty_pages;       // Dirty pages resident right now
+    uint64_t warmed_pages;      // Pages read back from the warm restart manifest
 } ObeliskBufferPoolStats;
 
 ObeliskBufferPoolStats buffer_pool_get_stats(ObeliskBufferPool* pool);
 void buffer_pool_reset_stats(ObeliskBufferPool* pool);
 
-// Memory management
+// Why a resident page lost its frame
+typedef enum {
+    OBELISK_EVICT_CLEAN = 0,    // Clean victim of a miss or new page
+    OBELISK_EVICT_DIRTY,        // Dirty victim, written back by the caller first
+    OBELISK_EVICT_PREFETCH,     // Victim of a prefetch or read-ahead
+    OBELISK_EVICT_RESIZE,       // Its frame was given up by a shrink
+    OBELISK_EVICT_REASON_COUNT
+} ObeliskEvictionReason;
+
+// Latencies by power of two: bucket i counts samples that took less than
+// 2^(i+1) ns but not less than 2^i ns, the last bucket everything longer
+#define OBELISK_LATENCY_BUCKETS 32
+
+typedef struct {
+    uint64_t buckets[OBELISK_LATENCY_BUCKETS];
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} ObeliskLatencyHistogram;
+
+// Upper bound in ns of the bucket holding the given fraction of samples
+// (0.99 for the 99th percentile); 0 for an empty histogram
+uint64_t buffer_pool_latency_percentile(const ObeliskLatencyHistogram* histogram, double fraction);
+
+typedef struct {
+    ObeliskBufferPoolStats stats;
+    uint64_t class_hits[OBELISK_PAGE_CLASS_COUNT];
+    uint64_t class_misses[OBELISK_PAGE_CLASS_COUNT];
+    uint64_t evictions_by_reason[OBELISK_EVICT_REASON_COUNT];
+    uint64_t victim_stalls;     // Misses and new pages that found no frame to evict
+    ObeliskLatencyHistogram miss_latency;   // Finding a frame and reading the page in
+    ObeliskLatencyHistogram flush_latency;  // Synchronous write-backs and cleaner writes
+} ObeliskBufferPoolSnapshot;
+
+// Copy every counter without taking a latch, so it is cheap enough to call
+// often and never holds up the pool. Counters are read one at a time while
+// they move, so they may be off from one another by what ran meanwhile.
+void buffer_pool_snapshot(ObeliskBufferPool* pool, ObeliskBufferPoolSnapshot* snapshot);
+
+// Memory management. Resizing runs alongside other calls: growing adds
+// frames, shrinking evicts the pages in the frames it gives up. A shrink
+// waits about a second for pinned pages in those frames and then fails, so
+// it cannot get past long-lived pins such as a B-tree's root or the nodes of
+// a concurrent tree. Pages returned unpinned by get_page must not be used
+// across a shrink, and a memory-only pool cannot give up frames holding
+// swizzled pages. A shard that fails keeps all its frames, but earlier
+// shards may already be resized, so the pool may be left partly resized.
 int buffer_pool_resize(ObeliskBufferPool* pool, size_t new_size);
 size_t buffer_pool_get_memory_usage(ObeliskBufferPool* pool);
 
@@ -66,7 +173,10 @@ size_t buffer_pool_get_memory_usage(ObeliskBufferPool* pool);
 typedef enum {
     OBELISK_POLICY_LRU,
     OBELISK_POLICY_CLOCK,
-    OBELISK_POLICY_LFU
+    OBELISK_POLICY_LFU,
+    OBELISK_POLICY_LRU_K,   // LRU-2: scan resistant
+    OBELISK_POLICY_2Q,      // Scan resistant
+    OBELISK_POLICY_ARC      // Scan resistant, self-tuning
 } ObeliskReplacementPolicy;
 
 int buffer_pool_set_policy(ObeliskBufferPool* pool, ObeliskReplacementPolicy policy);
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <obelisk/db.h>  // ObeliskColumn
 
 // Forward declarations
 typedef struct ObeliskStorage ObeliskStorage;
@@ -12,22 +13,29 @@ typedef struct ObeliskRecord ObeliskRecord;
 // Storage engine configuration
 typedef struct {
     const char* data_directory;     // Directory for data files
-    size_t page_size;              // Page size in bytes
-    bool enable_compression;        // Enable page compression
+    size_t page_size;              // Page size in bytes, at most 16 KiB; 0 for OBELISK_PAGE_SIZE
+    bool enable_compression;        // Compress pages written with storage_write_page
     bool enable_encryption;         // Enable page encryption
     const char* encryption_key;     // Encryption key if enabled
 } ObeliskStorageConfig;
 
-// Table information
+// Table information. Tables are stored as a chain of slotted heap pages;
+// first_page and last_page are 0 while a table has none.
 struct ObeliskTableInfo {
     char* table_name;
     uint32_t num_columns;
-    uint32_t record_size;
+    uint32_t record_size;       // Bytes of fixed-width columns; TEXT and BLOB values take what they need
     uint64_t num_records;
     uint64_t first_page;
     uint64_t last_page;
 };
 
+// A record id names a slot on a heap page. It stays valid while the record
+// lives, even when an update moves the record's bytes to another page.
+#define OBELISK_RECORD_ID(page, slot) (((uint64_t)(page) << 16) | (uint16_t)(slot))
+#define OBELISK_RECORD_PAGE(record_id) ((uint64_t)(record_id) >> 16)
+#define OBELISK_RECORD_SLOT(record_id) ((uint16_t)((record_id) & 0xFFFF))
+
 // Record structure
 struct ObeliskRecord {
     uint64_t record_id;
@@ -53,17 +61,40 @@ ObeliskStorage* storage_create(const ObeliskStorageConfig* config);
 void storage_destroy(ObeliskStorage* storage);
 
 // Table operations
-int storage_create_table(ObeliskStorage* storage, const char* table_name, const struct ObeliskColumn* columns, size_t num_columns);
+int storage_create_table(ObeliskStorage* storage, const char* table_name, const ObeliskColumn* columns, size_t num_columns);
 int storage_drop_table(ObeliskStorage* storage, const char* table_name);
-ObeliskTableInfo* storage_get_table_info(ObeliskStorage* storage, const char* table_name);
+ObeliskTableInfo* storage_get_table_info(ObeliskStorage* storage, const char* table_name);  // Released with free()
 
-// Record operations
-int storage_insert_record(ObeliskStorage* storage, const char* table_name, const ObeliskRecord* record);
+// Record operations. A record's data and timestamp are stored; insert
+// reports the id it assigned through record_id when that is not NULL.
+int storage_insert_record(ObeliskStorage* storage, const char* table_name, const ObeliskRecord* record, uint64_t* record_id);
 int storage_update_record(ObeliskStorage* storage, const char* table_name, uint64_t record_id, const ObeliskRecord* record);
 int storage_delete_record(ObeliskStorage* storage, const char* table_name, uint64_t record_id);
-ObeliskRecord* storage_get_record(ObeliskStorage* storage, const char* table_name, uint64_t record_id);
+ObeliskRecord* storage_get_record(ObeliskStorage* storage, const char* table_name, uint64_t record_id);  // Released with free()
+
+// Bulk loading. Records are packed into whole pages in memory and written a
+// batch of pages at a time, with the table's info and the storage stats
+// updated once per batch. insert_records stores n records, reporting their
+// ids through record_ids when that is not NULL; a record too large for a
+// page fails the call before any is stored.
+int storage_insert_records(ObeliskStorage* storage, const char* table_name, const ObeliskRecord* records,
+                           size_t n, uint64_t* record_ids);
+
+// A loader streams any number of records into a table the same way, COPY
+// style. Records can be read once their batch is written, and all of them
+// once finish returns; until then the table must not be changed by other
+// means or dropped. finish releases the loader and returns -1 if any
+// batch could not be written, leaving the batches before it stored.
+typedef struct ObeliskTableLoader ObeliskTableLoader;
+ObeliskTableLoader* storage_loader_begin(ObeliskStorage* storage, const char* table_name);
+int storage_loader_append(ObeliskTableLoader* loader, const ObeliskRecord* record, uint64_t* record_id);
+int storage_loader_finish(ObeliskTableLoader* loader);
 
-// Page operations
+// Page operations. Pages written by id are kept apart from tables and read
+// back as they were at the last checkpoint after a crash. allocate_page
+// returns a page-sized buffer, released with free(). Page ids must be below
+// OBELISK_STORAGE_MAX_PAGES.
+#define OBELISK_STORAGE_MAX_PAGES (1ULL << 28)
 void* storage_allocate_page(ObeliskStorage* storage);
 int storage_free_page(ObeliskStorage* storage, uint64_t page_id);
 int storage_write_page(ObeliskStorage* storage, uint64_t page_id, const void* data);
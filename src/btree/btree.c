@@ -1,146 +1,1231 @@
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
+#include <stddef.h>
 #include <obelisk/btree.h>
+#include <obelisk/buffer_pool.h>
+#include "btree_internal.h"
+
+static bool evict_node(void* ctx, ObeliskPage* page, bool evicting);
 
 ObeliskBTree* btree_create(void* page_manager) {
+    ObeliskBTreeConfig config = {
+        .page_manager = page_manager,
+        .concurrent = false,
+        .merge_threshold = OBELISK_BTREE_DEFAULT_MERGE_THRESHOLD
+    };
+    return btree_create_with_config(&config);
+}
+
+ObeliskBTree* btree_create_with_config(const ObeliskBTreeConfig* config) {
+    if (!config) return NULL;
+    if (!(config->merge_threshold >= 0.0 && config->merge_threshold <= 0.5)) return NULL;
+    if (config->buffered && config->concurrent) return NULL;
+    if (config->learned_error_bound > 0 && (config->concurrent || config->buffered)) return NULL;
+
+    void* page_manager = config->page_manager;
+    if (page_manager && buffer_pool_get_page_size(page_manager) < OBELISK_PAGE_SIZE) {
+        return NULL;  // Frames too small to hold a node
+    }
+
     ObeliskBTree* tree = malloc(sizeof(ObeliskBTree));
     if (!tree) return NULL;
 
+    tree->allocator = node_allocator_create(page_manager, OBELISK_PAGE_SIZE);
+    if (!tree->allocator) {
+        free(tree);
+        return NULL;
+    }
+
+    btree_search_init();
+
     tree->root = NULL;
     tree->num_nodes = 0;
     tree->height = 0;
     tree->page_manager = page_manager;
+    tree->concurrent = config->concurrent;
+    tree->merge_threshold = config->merge_threshold;
+    tree->buffered = config->buffered;
+    tree->pending_messages = 0;
+    tree->smo_count = 0;
+    tree->learned_error_bound = config->learned_error_bound;
+    tree->learned = NULL;
+    tree->evictable = false;
+    tree->epoch = 1;
+
+    // Concurrent readers cannot have nodes evicted under them, and a pool
+    // only has room for one owner of swizzled pages
+    if (page_manager && !config->concurrent &&
+        buffer_pool_set_eviction_callback(page_manager, evict_node, tree) == 0) {
+        tree->evictable = true;
+    }
 
     return tree;
 }
 
-void btree_destroy(ObeliskBTree* tree) {
-    if (!tree) return;
-    // TODO: Implement node cleanup with proper page deallocation
-    free(tree);
+// Swap every reference to and from node for page ids, leaving its page fit
+// to be written out. Returns whether the node changed since it was read.
+static bool unswizzle_node(ObeliskBTree* tree, ObeliskNode* node) {
+    uint64_t self = node_ref_from_page(node->page_id);
+
+    ObeliskNode* parent = node->parent;
+    if (parent) {
+        uint64_t* slots = node_children(parent);
+        for (uint32_t i = 0; i <= parent->num_keys; i++) {
+            if (slots[i] == node_ref(node)) {
+                slots[i] = self;
+                break;
+            }
+        }
+        node->parent = NULL;
+    }
+
+    if (node->type == OBELISK_NODE_LEAF) {
+        // Sibling links are swizzled in pairs, so a resident neighbour
+        // links back by address
+        if (node->next_leaf && !node_ref_is_page(node->next_leaf)) {
+            ObeliskNode* next = (ObeliskNode*)(uintptr_t)node->next_leaf;
+            next->prev_leaf = self;
+            node->next_leaf = node_ref_from_page(next->page_id);
+        }
+        if (node->prev_leaf && !node_ref_is_page(node->prev_leaf)) {
+            ObeliskNode* prev = (ObeliskNode*)(uintptr_t)node->prev_leaf;
+            prev->next_leaf = self;
+            node->prev_leaf = node_ref_from_page(prev->page_id);
+        }
+    } else {
+        uint64_t* children = node_children(node);
+        for (uint32_t i = 0; i <= node->num_keys; i++) {
+            if (node_ref_is_page(children[i])) continue;
+            ObeliskNode* child = (ObeliskNode*)(uintptr_t)children[i];
+            child->parent = NULL;
+            children[i] = node_ref_from_page(child->page_id);
+        }
+    }
+
+    bool dirty = node->is_dirty;
+    node->is_dirty = false;
+    return dirty;
+}
+
+// Nodes the current operation has reached stay; any other may go once the
+// references to it are unswizzled
+static bool evict_node(void* ctx, ObeliskPage* page, bool evicting) {
+    ObeliskBTree* tree = ctx;
+    ObeliskNode* node = page->data;
+    if (!evicting) return node->epoch != tree->epoch;
+    return unswizzle_node(tree, node);
+}
+
+// Bring a node in by page id. From here on the pool asks before evicting it.
+static ObeliskNode* load_node(ObeliskBTree* tree, uint64_t page_id) {
+    ObeliskPage* page = buffer_pool_fetch_page_class(tree->page_manager, page_id, OBELISK_PAGE_CLASS_INDEX);
+    if (!page) return NULL;
+
+    ObeliskNode* node = page->data;
+    btree_touch(tree, node);
+    buffer_pool_unpin_swizzled(tree->page_manager, page_id, false);
+    return node;
+}
+
+ObeliskNode* btree_load_ref(ObeliskBTree* tree, uint64_t ref) {
+    if (node_ref_is_page(ref)) return load_node(tree, node_ref_page_id(ref));
+
+    ObeliskNode* node = (ObeliskNode*)(uintptr_t)ref;
+    btree_touch(tree, node);
+    return node;
+}
+
+ObeliskNode* btree_load_child(ObeliskBTree* tree, ObeliskNode* node, uint32_t slot) {
+    uint64_t* children = node_children(node);
+    ObeliskNode* child = load_node(tree, node_ref_page_id(children[slot]));
+    if (!child) return NULL;
+
+    children[slot] = node_ref(child);
+    child->parent = node;
+    return child;
+}
+
+ObeliskNode* btree_next_leaf(ObeliskBTree* tree, ObeliskNode* leaf) {
+    uint64_t ref = leaf->next_leaf;
+    if (!node_ref_is_page(ref)) {
+        ObeliskNode* next = (ObeliskNode*)(uintptr_t)ref;
+        if (next) btree_touch(tree, next);
+        return next;
+    }
+
+    ObeliskNode* next = load_node(tree, node_ref_page_id(ref));
+    if (!next) return NULL;
+    leaf->next_leaf = node_ref(next);
+    next->prev_leaf = node_ref(leaf);
+    return next;
+}
+
+// Point the resident children in slots [from, to) of node back at it
+static void adopt_children(ObeliskBTree* tree, ObeliskNode* node, uint32_t from, uint32_t to) {
+    if (!tree->evictable) return;
+
+    uint64_t* children = node_children(node);
+    for (uint32_t i = from; i < to; i++) {
+        if (!node_ref_is_page(children[i])) ((ObeliskNode*)(uintptr_t)children[i])->parent = node;
+    }
+}
+
+// An evictable tree keeps its root pinned, so the pool never asks about it
+void btree_set_root(ObeliskBTree* tree, ObeliskNode* root) {
+    ObeliskNode* old_root = tree->root;
+    if (tree->evictable) {
+        if (root) {
+            root->parent = NULL;
+            buffer_pool_pin_page(tree->page_manager, root->page_id);
+        }
+        if (old_root) buffer_pool_unpin_swizzled(tree->page_manager, old_root->page_id, false);
+    }
+    __atomic_store_n(&tree->root, root, __ATOMIC_RELEASE);
 }
 
-static ObeliskNode* create_node(ObeliskNodeType type) {
-    ObeliskNode* node = malloc(sizeof(ObeliskNode));
+ObeliskNode* btree_node_alloc(ObeliskBTree* tree, ObeliskNodeType type) {
+    ObeliskNode* node = node_allocator_alloc(tree->allocator);
     if (!node) return NULL;
 
+    // Recycled nodes keep counting up from their old version so a reader
+    // still holding one from before it was freed cannot validate against it
+    node->version = (node->version | NODE_LOCKED | NODE_OBSOLETE) + 1;
     node->type = type;
     node->num_keys = 0;
+    node->next_leaf = 0;
+    node->prev_leaf = 0;
     node->parent = NULL;
     node->is_dirty = true;
-    node->page_id = 0;  // Assigned by page manager during persistence
+    if (type == OBELISK_NODE_BUFFERED) as_buffered(node)->num_msgs = 0;
 
+    // Reached by address from here on
+    if (tree->evictable) {
+        btree_touch(tree, node);
+        buffer_pool_unpin_swizzled(tree->page_manager, node->page_id, false);
+    }
+
+    __atomic_fetch_add(&tree->num_nodes, 1, __ATOMIC_RELAXED);
     return node;
 }
 
-bool btree_search(ObeliskBTree* tree, uint64_t key, uint64_t* value) {
-    if (!tree || !tree->root) return false;
+// Discard a node that is no longer part of the tree
+void btree_node_free(ObeliskBTree* tree, ObeliskNode* node) {
+    __atomic_fetch_sub(&tree->num_nodes, 1, __ATOMIC_RELAXED);
 
-    ObeliskNode* node = btree_find_leaf(tree, key);
-    if (!node) return false;
+    // A free node of an evictable tree gives up its frame and is reused by
+    // page id. One still pinned, by an iterator, waits on the free list.
+    if (tree->evictable) {
+        if (buffer_pool_delete_page(tree->page_manager, node->page_id) == 0) {
+            node_allocator_free_page(tree->allocator, node->page_id);
+            return;
+        }
+        buffer_pool_pin_page(tree->page_manager, node->page_id);
+    }
+    node_allocator_free(tree->allocator, node);
+}
 
-    // Binary search within node for O(log n) lookup
-    int left = 0, right = node->num_keys - 1;
-    while (left <= right) {
-        int mid = (left + right) / 2;
-        if (node->keys[mid] == key) {
-            if (value) *value = node->children[mid];  // Leaf nodes store values in children array
-            return true;
+// Children that cannot be brought in are left behind
+static void free_subtree(ObeliskBTree* tree, ObeliskNode* node) {
+    if (node->type != OBELISK_NODE_LEAF) {
+        for (uint32_t i = 0; i <= node->num_keys; i++) {
+            ObeliskNode* child = btree_child(tree, node, i);
+            if (child) free_subtree(tree, child);
         }
-        if (node->keys[mid] < key) {
-            left = mid + 1;
-        } else {
-            right = mid - 1;
+    }
+    btree_node_free(tree, node);
+}
+
+// Hand pool-backed pages back to the buffer pool, dirty ones for write-back
+static void release_pages(ObeliskBTree* tree, ObeliskNode* node) {
+    if (node->type != OBELISK_NODE_LEAF) {
+        for (uint32_t i = 0; i <= node->num_keys; i++) {
+            release_pages(tree, node_child(node, i));
         }
     }
+    buffer_pool_unpin_page(tree->page_manager, node->page_id, node->is_dirty);
+}
 
-    return false;
+// Unswizzle the resident nodes of an evictable tree, children first, and
+// hand their changes to the pool as an eviction would
+static void release_resident(ObeliskBTree* tree, ObeliskNode* node) {
+    if (node->type != OBELISK_NODE_LEAF) {
+        uint64_t* children = node_children(node);
+        for (uint32_t i = 0; i <= node->num_keys; i++) {
+            if (!node_ref_is_page(children[i])) {
+                release_resident(tree, (ObeliskNode*)(uintptr_t)children[i]);
+            }
+        }
+    }
+
+    bool dirty = unswizzle_node(tree, node);
+    if (node == tree->root) {
+        buffer_pool_unpin_page(tree->page_manager, node->page_id, dirty);
+    } else if (dirty && buffer_pool_pin_page(tree->page_manager, node->page_id) == 0) {
+        buffer_pool_unpin_page(tree->page_manager, node->page_id, true);
+    }
 }
 
-ObeliskNode* btree_find_leaf(ObeliskBTree* tree, uint64_t key) {
-    if (!tree || !tree->root) return NULL;
+void btree_destroy(ObeliskBTree* tree) {
+    if (!tree) return;
+
+    // Heap nodes all live in the allocator's slabs and go away with it
+    if (tree->evictable) {
+        if (tree->root) release_resident(tree, tree->root);
+        buffer_pool_set_eviction_callback(tree->page_manager, NULL, NULL);
+    } else if (tree->root && tree->page_manager) {
+        release_pages(tree, tree->root);
+    }
+    btree_drop_learned_index(tree);
+    node_allocator_destroy(tree->allocator);
+    free(tree);
+}
+
+size_t btree_get_memory_usage(ObeliskBTree* tree) {
+    if (!tree) return 0;
+    return sizeof(ObeliskBTree) + node_allocator_memory_usage(tree->allocator) +
+           btree_learned_memory_usage(tree);
+}
+
+static ObeliskNode* find_leaf(ObeliskBTree* tree, uint64_t key);
+
+// 1 found, 0 absent, -1 if a node on the way could not be read
+static int search_leaf(ObeliskBTree* tree, uint64_t key, uint64_t* value) {
+    if (!tree->root) return 0;
+    ObeliskNode* node = find_leaf(tree, key);
+    if (!node) return -1;
+
+    // The slot before the upper bound holds the key if it is present
+    ObeliskLeafNode* leaf = as_leaf(node);
+    uint32_t pos = btree_node_upper_bound(leaf->keys, node->num_keys, key);
+    if (pos == 0 || leaf->keys[pos - 1] != key) return 0;
+
+    if (value) *value = leaf->values[pos - 1];
+    return 1;
+}
+
+// One lookup in a tree that is not concurrent, as its own operation
+static int search_one(ObeliskBTree* tree, uint64_t key, uint64_t* value) {
+    int rc = tree->buffered ? btree_buffered_search(tree, key, value)
+                            : search_leaf(tree, key, value);
+    btree_op_end(tree);
+    return rc;
+}
+
+bool btree_search(ObeliskBTree* tree, uint64_t key, uint64_t* value) {
+    if (!tree) return false;
+    if (tree->concurrent) return btree_olc_search(tree, key, value);
+    return search_one(tree, key, value) > 0;
+}
+
+static ObeliskNode* find_leaf(ObeliskBTree* tree, uint64_t key) {
+    if (!tree->root) return NULL;
+    if (tree->buffered && btree_buffered_drain(tree) != 0) return NULL;
+
+    if (tree->learned) {
+        ObeliskNode* leaf = btree_learned_find_leaf(tree, key);
+        if (leaf) return leaf;
+    }
 
     ObeliskNode* node = tree->root;
-    while (node->type == OBELISK_NODE_INTERNAL) {
-        int i;
-        for (i = 0; i < node->num_keys; i++) {
-            if (key < node->keys[i]) break;
-        }
-        node = (ObeliskNode*)(uintptr_t)node->children[i];
+    while (node && node->type != OBELISK_NODE_LEAF) {
+        uint32_t i = btree_node_upper_bound(node_keys(node), node->num_keys, key);
+        node = btree_child(tree, node, i);
     }
 
     return node;
 }
 
-int btree_insert(ObeliskBTree* tree, uint64_t key, uint64_t value) {
-    if (!tree) return -1;
+ObeliskNode* btree_find_leaf(ObeliskBTree* tree, uint64_t key) {
+    if (!tree) return NULL;
+
+    ObeliskNode* leaf = find_leaf(tree, key);
+    btree_op_end(tree);
+    return leaf;
+}
+
+// Lookups in flight per group; enough to cover memory latency without
+// overflowing the core's outstanding-miss buffers
+#define BTREE_BATCH_GROUP 16
+
+// Header plus the leading key lines; the key scan is sequential, so the
+// hardware prefetcher picks up the rest of the page once it starts
+#define BTREE_PREFETCH_SPAN 256
+
+static inline void prefetch_node(const ObeliskNode* node) {
+    const char* base = (const char*)node;
+    for (size_t offset = 0; offset < BTREE_PREFETCH_SPAN; offset += 64) {
+        __builtin_prefetch(base + offset, 0, 3);
+    }
+}
+
+size_t btree_search_batch(ObeliskBTree* tree, const uint64_t* keys, size_t n,
+                          uint64_t* values, bool* found) {
+    if (!tree || !keys) return 0;
+
+    bool olc = tree->concurrent;
+    bool failed = false;
+    size_t hits = 0;
+
+    // Buffered lookups must consult each buffer on the way, so go one by
+    // one, each its own operation so the nodes it read may be evicted again
+    if (tree->buffered) {
+        for (size_t i = 0; i < n; i++) {
+            uint64_t value = 0;
+            int rc = search_one(tree, keys[i], &value);
+            if (found) found[i] = rc > 0;
+            if (values) values[i] = rc > 0 ? value : 0;
+            hits += rc > 0;
+            failed |= rc < 0;
+        }
+        return failed ? OBELISK_BTREE_BATCH_ERROR : hits;
+    }
+
+    for (size_t base = 0; base < n; base += BTREE_BATCH_GROUP) {
+        size_t group = n - base < BTREE_BATCH_GROUP ? n - base : BTREE_BATCH_GROUP;
+        ObeliskNode* nodes[BTREE_BATCH_GROUP];
+        ObeliskNode* parents[BTREE_BATCH_GROUP];
+        uint64_t versions[BTREE_BATCH_GROUP];
+        uint64_t parent_versions[BTREE_BATCH_GROUP];
+        bool retry[BTREE_BATCH_GROUP];
+
+        ObeliskNode* root = __atomic_load_n(&tree->root, __ATOMIC_ACQUIRE);
+        for (size_t j = 0; j < group; j++) {
+            nodes[j] = root;
+            parents[j] = NULL;
+            retry[j] = false;
+            if (olc && root) {
+                versions[j] = node_read_lock(root, &retry[j]);
+                if (root != __atomic_load_n(&tree->root, __ATOMIC_ACQUIRE)) retry[j] = true;
+            }
+        }
+
+        // Each round moves every lookup down one level. Children are only
+        // prefetched in the round that finds them and read in the next one.
+        bool descending = root != NULL;
+        while (descending) {
+            descending = false;
+            for (size_t j = 0; j < group; j++) {
+                if (retry[j] || !nodes[j]) continue;
+                ObeliskNode* node = nodes[j];
+
+                if (olc && parents[j]) {
+                    versions[j] = node_read_lock(node, &retry[j]);
+                    if (retry[j] || !node_validate(parents[j], parent_versions[j])) {
+                        retry[j] = true;
+                        continue;
+                    }
+                    parents[j] = NULL;
+                }
+                if (node->type != OBELISK_NODE_INTERNAL) continue;
+
+                uint32_t count = olc ? node_key_count(node) : node->num_keys;
+                uint32_t slot = btree_node_upper_bound(node_keys(node), count, keys[base + j]);
+                ObeliskNode* child = olc ? node_child(node, slot) : btree_child(tree, node, slot);
+                if (!child) {
+                    // Could not be brought in, perhaps because the group's
+                    // other nodes hold the frames; redone alone below
+                    retry[j] = true;
+                    continue;
+                }
+                if (olc) {
+                    if (!node_validate(node, versions[j])) {
+                        retry[j] = true;
+                        continue;
+                    }
+                    parents[j] = node;
+                    parent_versions[j] = versions[j];
+                }
+
+                prefetch_node(child);
+                nodes[j] = child;
+                descending = true;
+            }
+        }
+
+        for (size_t j = 0; j < group; j++) {
+            uint64_t key = keys[base + j];
+            uint64_t value = 0;
+            bool hit = false;
+            ObeliskNode* leaf = nodes[j];
+
+            if (leaf && !retry[j]) {
+                uint32_t count = olc ? node_key_count(leaf) : leaf->num_keys;
+                uint32_t pos = btree_node_upper_bound(as_leaf(leaf)->keys, count, key);
+                hit = pos > 0 && as_leaf(leaf)->keys[pos - 1] == key;
+                if (hit) value = as_leaf(leaf)->values[pos - 1];
+                if (olc && !node_validate(leaf, versions[j])) retry[j] = true;
+            }
+            if (retry[j]) {
+                if (!olc) continue;
+                // Raced with a writer; redo this one lookup on its own
+                hit = btree_olc_search(tree, key, &value);
+            }
 
+            if (found) found[base + j] = hit;
+            if (values) values[base + j] = hit ? value : 0;
+            hits += hit;
+        }
+
+        // Nothing from this group is needed by the next
+        btree_op_end(tree);
+
+        // Lookups that found no frame go again with nothing else held
+        for (size_t j = 0; j < group && !olc; j++) {
+            if (!retry[j]) continue;
+            uint64_t value = 0;
+            int rc = search_one(tree, keys[base + j], &value);
+            if (found) found[base + j] = rc > 0;
+            if (values) values[base + j] = rc > 0 ? value : 0;
+            hits += rc > 0;
+            failed |= rc < 0;
+        }
+    }
+
+    return failed ? OBELISK_BTREE_BATCH_ERROR : hits;
+}
+
+// Put a new root above the current one and split the old root into it
+int btree_grow_root(ObeliskBTree* tree) {
+    ObeliskNode* old_root = tree->root;
+    ObeliskNode* new_root = btree_node_alloc(tree, tree->buffered ? OBELISK_NODE_BUFFERED
+                                                                   : OBELISK_NODE_INTERNAL);
+    if (!new_root) return -1;
+
+    node_children(new_root)[0] = node_ref(old_root);
+    if (btree_split_child(tree, new_root, 0, old_root) != 0) {
+        btree_node_free(tree, new_root);
+        return -1;
+    }
+
+    btree_set_root(tree, new_root);
+    if (tree->evictable) old_root->parent = new_root;
+    __atomic_fetch_add(&tree->height, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static int insert_key(ObeliskBTree* tree, uint64_t key, uint64_t value) {
     if (!tree->root) {
-        tree->root = create_node(OBELISK_NODE_LEAF);
-        if (!tree->root) return -1;
-        tree->root->keys[0] = key;
-        tree->root->children[0] = value;
-        tree->root->num_keys = 1;
+        ObeliskNode* root = btree_node_alloc(tree, OBELISK_NODE_LEAF);
+        if (!root) return -1;
+        btree_leaf_insert(root, 0, key, value);
+        btree_set_root(tree, root);
         tree->height = 1;
-        tree->num_nodes = 1;
         return 0;
     }
 
-    ObeliskNode* leaf = btree_find_leaf(tree, key);
-    if (!leaf) return -1;
+    // Grow a new root before descending so every split has room in its parent
+    if (node_is_full(tree->root) && btree_grow_root(tree) != 0) return -1;
+
+    // Descend, splitting full children on the way down
+    ObeliskNode* node = tree->root;
+    while (node->type == OBELISK_NODE_INTERNAL) {
+        uint32_t i = btree_node_upper_bound(node_keys(node), node->num_keys, key);
+
+        ObeliskNode* child = btree_child(tree, node, i);
+        if (!child) return -1;
+        if (node_is_full(child)) {
+            if (btree_split_child(tree, node, i, child) != 0) return -1;
+            if (key >= node_keys(node)[i]) {
+                child = btree_child(tree, node, i + 1);
+            }
+        }
+        node = child;
+    }
+
+    ObeliskLeafNode* leaf = as_leaf(node);
+    uint32_t i = btree_node_upper_bound(leaf->keys, node->num_keys, key);
 
     // Update value if key exists
-    for (uint32_t i = 0; i < leaf->num_keys; i++) {
-        if (leaf->keys[i] == key) {
-            leaf->children[i] = value;
-            leaf->is_dirty = true;
-            return 0;
+    if (i > 0 && leaf->keys[i - 1] == key) {
+        leaf->values[i - 1] = value;
+        node->is_dirty = true;
+        return 0;
+    }
+
+    btree_leaf_insert(node, i, key, value);
+    return 0;
+}
+
+int btree_insert(ObeliskBTree* tree, uint64_t key, uint64_t value) {
+    if (!tree) return -1;
+    if (tree->concurrent) return btree_olc_insert(tree, key, value);
+
+    int rc = tree->buffered ? btree_buffered_insert(tree, key, value)
+                            : insert_key(tree, key, value);
+    btree_op_end(tree);
+    return rc;
+}
+
+int btree_split_child(ObeliskBTree* tree, ObeliskNode* parent, int index, ObeliskNode* child) {
+    if (!tree || !parent || !child || node_is_full(parent)) return -1;
+    if (index < 0 || (uint32_t)index > parent->num_keys) return -1;
+    if (child->num_keys < 2) return -1;
+    btree_touch(tree, parent);
+    btree_touch(tree, child);
+
+    ObeliskNode* sibling = btree_node_alloc(tree, child->type);
+    if (!sibling) return -1;
+
+    // The leaf after child links back to the new sibling
+    ObeliskNode* next = NULL;
+    if (child->type == OBELISK_NODE_LEAF && child->next_leaf) {
+        next = btree_next_leaf(tree, child);
+        if (!next) {
+            btree_node_free(tree, sibling);
+            return -1;
         }
     }
 
-    // Insert into leaf if space available
-    if (leaf->num_keys < OBELISK_BTREE_ORDER - 1) {
-        uint32_t i = leaf->num_keys;
-        while (i > 0 && leaf->keys[i-1] > key) {
-            leaf->keys[i] = leaf->keys[i-1];
-            leaf->children[i] = leaf->children[i-1];
-            i--;
+    uint32_t mid = child->num_keys / 2;
+    uint64_t separator;
+
+    if (child->type == OBELISK_NODE_LEAF) {
+        // Right half moves to the sibling; its first key is copied up
+        ObeliskLeafNode* left = as_leaf(child);
+        ObeliskLeafNode* right = as_leaf(sibling);
+        uint32_t count = child->num_keys - mid;
+        memcpy(right->keys, &left->keys[mid], count * sizeof(uint64_t));
+        memcpy(right->values, &left->values[mid], count * sizeof(uint64_t));
+        sibling->num_keys = count;
+        child->num_keys = mid;
+        separator = right->keys[0];
+
+        sibling->next_leaf = node_ref(next);
+        sibling->prev_leaf = node_ref(child);
+        if (next) {
+            next->prev_leaf = node_ref(sibling);
+            next->is_dirty = true;
         }
-        leaf->keys[i] = key;
-        leaf->children[i] = value;
+        child->next_leaf = node_ref(sibling);
+    } else {
+        // Middle key moves up; keys and children right of it move to the sibling
+        uint64_t* left_keys = node_keys(child);
+        uint64_t* right_keys = node_keys(sibling);
+        uint32_t count = child->num_keys - mid - 1;
+        separator = left_keys[mid];
+        memcpy(right_keys, &left_keys[mid + 1], count * sizeof(uint64_t));
+        memcpy(node_children(sibling), &node_children(child)[mid + 1], (count + 1) * sizeof(uint64_t));
+        sibling->num_keys = count;
+        child->num_keys = mid;
+        adopt_children(tree, sibling, 0, count + 1);
+
+        // Pending messages follow the keys they belong to
+        if (child->type == OBELISK_NODE_BUFFERED) {
+            ObeliskBufferedNode* left = as_buffered(child);
+            ObeliskBufferedNode* right = as_buffered(sibling);
+            uint32_t keep = 0;
+            while (keep < left->num_msgs && left->msg_keys[keep] < separator) keep++;
+
+            uint32_t moved = left->num_msgs - keep;
+            memcpy(right->msg_keys, &left->msg_keys[keep], moved * sizeof(uint64_t));
+            memcpy(right->msg_values, &left->msg_values[keep], moved * sizeof(uint64_t));
+            memcpy(right->msg_ops, &left->msg_ops[keep], moved);
+            right->num_msgs = moved;
+            left->num_msgs = keep;
+        }
+    }
+
+    // Make room for the separator and new child in the parent
+    uint64_t* parent_keys = node_keys(parent);
+    uint64_t* parent_children = node_children(parent);
+    memmove(&parent_keys[index + 1], &parent_keys[index],
+            (parent->num_keys - index) * sizeof(uint64_t));
+    memmove(&parent_children[index + 2], &parent_children[index + 1],
+            (parent->num_keys - index) * sizeof(uint64_t));
+    parent_keys[index] = separator;
+    parent_children[index + 1] = node_ref(sibling);
+    parent->num_keys++;
+    if (tree->evictable) sibling->parent = parent;
+
+    parent->is_dirty = true;
+    child->is_dirty = true;
+    __atomic_fetch_add(&tree->smo_count, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+// Bulk loading: entries of the level just built, used to pack the level above.
+// An evictable tree refers to them by page id, so a finished node can be
+// evicted before there is a parent to swizzle it.
+typedef struct {
+    uint64_t min_key;
+    uint64_t ref;
+} LoadEntry;
+
+typedef struct {
+    LoadEntry* items;
+    size_t count;
+    size_t capacity;
+} LoadLevel;
+
+static int load_level_push(ObeliskBTree* tree, LoadLevel* level, uint64_t min_key, ObeliskNode* node) {
+    if (level->count == level->capacity) {
+        size_t capacity = level->capacity ? level->capacity * 2 : 64;
+        LoadEntry* items = realloc(level->items, capacity * sizeof(LoadEntry));
+        if (!items) return -1;
+        level->items = items;
+        level->capacity = capacity;
+    }
+    level->items[level->count].min_key = min_key;
+    level->items[level->count].ref = tree->evictable ? node_ref_from_page(node->page_id) : node_ref(node);
+    level->count++;
+    return 0;
+}
+
+static ObeliskNode* load_entry_node(ObeliskBTree* tree, const LoadEntry* entry) {
+    return btree_load_ref(tree, entry->ref);
+}
+
+// Pack the nodes of one level under new internal nodes of up to `target` children
+static int load_build_parents(ObeliskBTree* tree, const LoadLevel* children,
+                              LoadLevel* parents, uint32_t target) {
+    size_t i = 0;
+    while (i < children->count) {
+        size_t remaining = children->count - i;
+        size_t group = remaining <= target ? remaining : target;
+        if (remaining > target && remaining - target < 2) {
+            group = remaining - 2;  // Never leave a trailing node with a single child
+        }
+
+        ObeliskNode* node = btree_node_alloc(tree, tree->buffered ? OBELISK_NODE_BUFFERED
+                                                                  : OBELISK_NODE_INTERNAL);
+        if (!node) return -1;
+        if (load_level_push(tree, parents, children->items[i].min_key, node) != 0) {
+            btree_node_free(tree, node);
+            return -1;
+        }
+
+        for (size_t j = 0; j < group; j++) {
+            if (j > 0) {
+                node_keys(node)[j - 1] = children->items[i + j].min_key;
+            }
+            node_children(node)[j] = children->items[i + j].ref;
+        }
+        node->num_keys = (uint32_t)group - 1;
+        btree_release(tree, node);
+        i += group;
+    }
+    return 0;
+}
+
+int btree_bulk_load(ObeliskBTree* tree, ObeliskBTreeLoadFn next, void* ctx, double fill_factor) {
+    if (!tree || !next || tree->root) return -1;
+    if (!(fill_factor > 0.0 && fill_factor <= 1.0)) return -1;
+
+    uint32_t leaf_target = (uint32_t)(fill_factor * BTREE_LEAF_MAX_KEYS);
+    uint32_t fanout = tree->buffered ? OBELISK_BTREE_BUFFERED_FANOUT : OBELISK_BTREE_ORDER;
+    uint32_t inner_target = (uint32_t)(fill_factor * fanout);
+    if (leaf_target < 1) leaf_target = 1;
+    if (inner_target < 3) inner_target = 3;
+
+    LoadLevel level = {0};
+    LoadLevel above = {0};
+    ObeliskNode* leaf = NULL;
+    uint64_t key, value, last_key = 0;
+    uint64_t height = 1;
+    int rc = -1;
+
+    // Fill leaves left to right; page allocation order matches key order
+    while (next(ctx, &key, &value)) {
+        if (leaf && key <= last_key) goto fail;  // Input must be strictly ascending
+        last_key = key;
+
+        if (!leaf || leaf->num_keys == leaf_target) {
+            ObeliskNode* fresh = btree_node_alloc(tree, OBELISK_NODE_LEAF);
+            if (!fresh) goto fail;
+            if (load_level_push(tree, &level, key, fresh) != 0) {
+                btree_node_free(tree, fresh);
+                goto fail;
+            }
+            if (leaf) {
+                leaf->next_leaf = node_ref(fresh);
+                fresh->prev_leaf = node_ref(leaf);
+                btree_release(tree, leaf);
+            }
+            leaf = fresh;
+        }
+
+        as_leaf(leaf)->keys[leaf->num_keys] = key;
+        as_leaf(leaf)->values[leaf->num_keys] = value;
         leaf->num_keys++;
-        leaf->is_dirty = true;
-        return 0;
     }
 
-    // TODO: Implement node splitting for B-tree balancing
-    return -1;
+    if (level.count == 0) {
+        rc = 0;  // Empty input leaves the tree empty
+        goto done;
+    }
+
+    // Then each internal level from the one below it until a single root remains
+    while (level.count > 1) {
+        above.count = 0;
+        if (load_build_parents(tree, &level, &above, inner_target) != 0) goto fail;
+
+        LoadLevel swap = level;
+        level = above;
+        above = swap;
+        height++;
+    }
+
+    ObeliskNode* root = load_entry_node(tree, &level.items[0]);
+    if (!root) goto fail;
+    btree_set_root(tree, root);
+    tree->height = height;
+    rc = 0;
+
+    // The model only speeds up lookups, so the load stands without it
+    if (tree->learned_error_bound > 0) {
+        btree_build_learned_index(tree, tree->learned_error_bound);
+    }
+    goto done;
+
+fail:
+    // Parents of a partially built level own no complete subtree yet; every
+    // node below them is still reachable from `level`.
+    for (size_t i = 0; i < above.count; i++) {
+        ObeliskNode* node = load_entry_node(tree, &above.items[i]);
+        if (node) btree_node_free(tree, node);
+    }
+    for (size_t i = 0; i < level.count; i++) {
+        ObeliskNode* node = load_entry_node(tree, &level.items[i]);
+        if (node) free_subtree(tree, node);
+    }
+
+done:
+    free(level.items);
+    free(above.items);
+    btree_op_end(tree);
+    return rc;
+}
+
+// Two nodes are only merged when the result leaves a quarter of the node
+// free; otherwise the next few inserts would split it straight back apart
+static bool merge_fits(const ObeliskNode* left, const ObeliskNode* right) {
+    uint32_t max = node_max_keys(left);
+    uint32_t combined = left->num_keys + right->num_keys;
+    if (left->type != OBELISK_NODE_LEAF) combined++;  // Separator comes down
+    return combined <= max - max / 4;
+}
+
+int btree_merge_nodes(ObeliskBTree* tree, ObeliskNode* parent, int index) {
+    if (!tree || !parent || parent->type == OBELISK_NODE_LEAF) return -1;
+    if (index < 0 || (uint32_t)index >= parent->num_keys) return -1;
+
+    btree_touch(tree, parent);
+    ObeliskNode* left = btree_child(tree, parent, (uint32_t)index);
+    ObeliskNode* right = left ? btree_child(tree, parent, (uint32_t)index + 1) : NULL;
+    if (!right) return -1;
+    uint32_t max = node_max_keys(left);
+    uint32_t a = left->num_keys;
+    uint32_t b = right->num_keys;
+
+    if (left->type == OBELISK_NODE_LEAF) {
+        if (a + b > max) return -1;
+
+        // The leaf after right links back to left instead
+        ObeliskNode* next = NULL;
+        if (right->next_leaf) {
+            next = btree_next_leaf(tree, right);
+            if (!next) return -1;
+        }
+
+        ObeliskLeafNode* dst = as_leaf(left);
+        ObeliskLeafNode* src = as_leaf(right);
+        memcpy(&dst->keys[a], src->keys, b * sizeof(uint64_t));
+        memcpy(&dst->values[a], src->values, b * sizeof(uint64_t));
+
+        left->next_leaf = node_ref(next);
+        if (next) {
+            next->prev_leaf = node_ref(left);
+            next->is_dirty = true;
+        }
+    } else {
+        // The separator comes down between the two key runs
+        if (a + b + 1 > max) return -1;
+
+        // Every message on the left sorts before every message on the right
+        if (left->type == OBELISK_NODE_BUFFERED) {
+            ObeliskBufferedNode* dst = as_buffered(left);
+            ObeliskBufferedNode* src = as_buffered(right);
+            uint32_t m = dst->num_msgs;
+            if (m + src->num_msgs > OBELISK_BTREE_BUFFER_CAPACITY) return -1;
+            memcpy(&dst->msg_keys[m], src->msg_keys, src->num_msgs * sizeof(uint64_t));
+            memcpy(&dst->msg_values[m], src->msg_values, src->num_msgs * sizeof(uint64_t));
+            memcpy(&dst->msg_ops[m], src->msg_ops, src->num_msgs);
+            dst->num_msgs = m + src->num_msgs;
+        }
+
+        uint64_t* dst_keys = node_keys(left);
+        dst_keys[a] = node_keys(parent)[index];
+        memcpy(&dst_keys[a + 1], node_keys(right), b * sizeof(uint64_t));
+        memcpy(&node_children(left)[a + 1], node_children(right), (b + 1) * sizeof(uint64_t));
+        adopt_children(tree, left, a + 1, a + b + 2);
+        b++;
+    }
+    left->num_keys = a + b;
+
+    // Drop the separator and the right child from the parent
+    uint64_t* parent_keys = node_keys(parent);
+    uint64_t* parent_children = node_children(parent);
+    uint32_t tail = parent->num_keys - (uint32_t)index - 1;
+    memmove(&parent_keys[index], &parent_keys[index + 1], tail * sizeof(uint64_t));
+    memmove(&parent_children[index + 1], &parent_children[index + 2], tail * sizeof(uint64_t));
+    parent->num_keys--;
+
+    parent->is_dirty = true;
+    left->is_dirty = true;
+    btree_node_free(tree, right);
+    tree->smo_count++;
+    return 0;
+}
+
+// Even out children index and index + 1 of parent, left and right, rotating
+// entries through the separator. Buffered children must have empty buffers.
+static void redistribute(ObeliskBTree* tree, ObeliskNode* parent, uint32_t index,
+                         ObeliskNode* left, ObeliskNode* right) {
+    uint64_t* separator = &node_keys(parent)[index];
+    uint32_t a = left->num_keys;
+    uint32_t b = right->num_keys;
+    uint32_t target = (a + b) / 2;
+    if (target == a) return;
+
+    if (left->type == OBELISK_NODE_LEAF) {
+        ObeliskLeafNode* l = as_leaf(left);
+        ObeliskLeafNode* r = as_leaf(right);
+        if (a > target) {
+            uint32_t k = a - target;
+            memmove(&r->keys[k], r->keys, b * sizeof(uint64_t));
+            memmove(&r->values[k], r->values, b * sizeof(uint64_t));
+            memcpy(r->keys, &l->keys[target], k * sizeof(uint64_t));
+            memcpy(r->values, &l->values[target], k * sizeof(uint64_t));
+        } else {
+            uint32_t k = target - a;
+            memcpy(&l->keys[a], r->keys, k * sizeof(uint64_t));
+            memcpy(&l->values[a], r->values, k * sizeof(uint64_t));
+            memmove(r->keys, &r->keys[k], (b - k) * sizeof(uint64_t));
+            memmove(r->values, &r->values[k], (b - k) * sizeof(uint64_t));
+        }
+        left->num_keys = target;
+        right->num_keys = a + b - target;
+        *separator = r->keys[0];
+    } else {
+        uint64_t* l_keys = node_keys(left);
+        uint64_t* r_keys = node_keys(right);
+        uint64_t* l_children = node_children(left);
+        uint64_t* r_children = node_children(right);
+        if (a > target) {
+            // Tail of left plus the old separator move to the front of right
+            uint32_t k = a - target;
+            memmove(&r_keys[k], r_keys, b * sizeof(uint64_t));
+            memmove(&r_children[k], r_children, (b + 1) * sizeof(uint64_t));
+            r_keys[k - 1] = *separator;
+            memcpy(r_keys, &l_keys[target + 1], (k - 1) * sizeof(uint64_t));
+            memcpy(r_children, &l_children[target + 1], k * sizeof(uint64_t));
+            *separator = l_keys[target];
+            adopt_children(tree, right, 0, k);
+        } else {
+            // Old separator plus the head of right move to the tail of left
+            uint32_t k = target - a;
+            l_keys[a] = *separator;
+            memcpy(&l_keys[a + 1], r_keys, (k - 1) * sizeof(uint64_t));
+            memcpy(&l_children[a + 1], r_children, k * sizeof(uint64_t));
+            adopt_children(tree, left, a + 1, a + k + 1);
+            *separator = r_keys[k - 1];
+            memmove(r_keys, &r_keys[k], (b - k) * sizeof(uint64_t));
+            memmove(r_children, &r_children[k], (b - k + 1) * sizeof(uint64_t));
+        }
+        left->num_keys = target;
+        right->num_keys = a + b - target;
+    }
+
+    parent->is_dirty = true;
+    left->is_dirty = true;
+    right->is_dirty = true;
+    tree->smo_count++;
 }
 
-int btree_split_child(ObeliskNode* parent, int index, ObeliskNode* child) {
-    // TODO: Implement node splitting with proper page allocation
-    return -1;
+// Fix up the underfull child at slot by merging it with a neighbour or
+// borrowing from one. Returns true if the parent lost a key. The callers are
+// done with both children afterwards.
+static bool rebalance_child(ObeliskBTree* tree, ObeliskNode* parent, uint32_t slot) {
+    uint32_t index = slot > 0 ? slot - 1 : slot;
+    ObeliskNode* left = btree_child(tree, parent, index);
+    ObeliskNode* right = left ? btree_child(tree, parent, index + 1) : NULL;
+    if (!right) return false;
+
+    if (merge_fits(left, right)) {
+        bool merged = btree_merge_nodes(tree, parent, (int)index) == 0;
+        btree_release(tree, left);
+        if (!merged) btree_release(tree, right);
+        return merged;
+    }
+    redistribute(tree, parent, index, left, right);
+    btree_release(tree, left);
+    btree_release(tree, right);
+    return false;
+}
+
+// Replace an empty root with its only child, or drop it if it is a leaf
+static void shrink_root(ObeliskBTree* tree) {
+    while (tree->root && tree->root->num_keys == 0) {
+        ObeliskNode* old_root = tree->root;
+        ObeliskNode* new_root = NULL;
+        if (old_root->type != OBELISK_NODE_LEAF) {
+            new_root = btree_child(tree, old_root, 0);
+            if (!new_root) return;
+        }
+        btree_set_root(tree, new_root);
+        tree->height--;
+        btree_node_free(tree, old_root);
+        tree->smo_count++;
+    }
+}
+
+static uint32_t merge_min_keys(const ObeliskBTree* tree, const ObeliskNode* node) {
+    if (tree->merge_threshold <= 0.0) return 0;
+
+    uint32_t min = (uint32_t)(tree->merge_threshold * node_max_keys(node));
+    return min > 0 ? min : 1;
+}
+
+// Deep enough for any tree whose node count fits in memory
+#define BTREE_MAX_HEIGHT 32
+
+static int delete_key(ObeliskBTree* tree, uint64_t key) {
+    if (!tree->root || tree->height > BTREE_MAX_HEIGHT) return -1;
+
+    // Remember the path so underflow can be fixed on the way back up
+    ObeliskNode* path[BTREE_MAX_HEIGHT];
+    uint32_t slots[BTREE_MAX_HEIGHT];
+    uint32_t depth = 0;
+
+    ObeliskNode* node = tree->root;
+    while (node->type == OBELISK_NODE_INTERNAL) {
+        uint32_t i = btree_node_upper_bound(node_keys(node), node->num_keys, key);
+        path[depth] = node;
+        slots[depth] = i;
+        depth++;
+        node = btree_child(tree, node, i);
+        if (!node) return -1;
+    }
+
+    uint32_t pos = btree_node_upper_bound(node_keys(node), node->num_keys, key);
+    if (pos == 0 || node_keys(node)[pos - 1] != key) return -1;
+    btree_leaf_remove(node, pos - 1);
+
+    // Separators stay valid bounds after a removal, so only occupancy matters
+    while (depth > 0 && node->num_keys < merge_min_keys(tree, node)) {
+        depth--;
+        if (!rebalance_child(tree, path[depth], slots[depth])) break;
+        node = path[depth];
+    }
+
+    shrink_root(tree);
+    return 0;
 }
 
 int btree_delete(ObeliskBTree* tree, uint64_t key) {
-    // TODO: Implement deletion with proper rebalancing
-    return -1;
+    if (!tree) return -1;
+    if (tree->concurrent) return btree_olc_delete(tree, key);
+
+    int rc = tree->buffered ? btree_buffered_delete(tree, key) : delete_key(tree, key);
+    btree_op_end(tree);
+    return rc;
+}
+
+static int compact_node(ObeliskBTree* tree, ObeliskNode* node) {
+    if (node->type == OBELISK_NODE_LEAF) return 0;
+
+    for (uint32_t i = 0; i <= node->num_keys; i++) {
+        ObeliskNode* child = btree_child(tree, node, i);
+        if (!child || compact_node(tree, child) != 0) return -1;
+        btree_release(tree, child);
+    }
+
+    // Children are compacted first, so each merge here sees final sizes
+    uint32_t slot = 0;
+    while (node->num_keys > 0 && slot <= node->num_keys) {
+        ObeliskNode* child = btree_child(tree, node, slot);
+        if (!child) return -1;
+        if (child->num_keys >= node_max_keys(child) / 2) {
+            btree_release(tree, child);
+            slot++;
+        } else if (!rebalance_child(tree, node, slot)) {
+            slot++;
+        }
+    }
+    return 0;
+}
+
+static int compact_tree(ObeliskBTree* tree) {
+    if (tree->buffered && btree_buffered_drain(tree) != 0) return -1;
+    if (!tree->root) return 0;
+
+    // Merging internal nodes brings sparse children side by side again, so
+    // repeat until a pass frees nothing
+    uint64_t nodes;
+    do {
+        nodes = tree->num_nodes;
+        if (compact_node(tree, tree->root) != 0) return -1;
+        shrink_root(tree);
+    } while (tree->root && tree->num_nodes < nodes);
+    return 0;
 }
 
-int btree_merge_nodes(ObeliskNode* left, ObeliskNode* right) {
-    // TODO: Implement node merging for deletion rebalancing
-    return -1;
+int btree_compact(ObeliskBTree* tree) {
+    if (!tree) return -1;
+
+    int rc = compact_tree(tree);
+    btree_op_end(tree);
+    return rc;
+}
+
+static void print_node(ObeliskBTree* tree, ObeliskNode* node, uint64_t depth) {
+    static const char* const kinds[] = { "leaf", "internal", "buffered" };
+    const uint64_t* keys = node_keys(node);
+    printf("%*s%s page=%llu keys=%u [", (int)(depth * 2), "", kinds[node->type],
+           (unsigned long long)node->page_id, node->num_keys);
+    for (uint32_t i = 0; i < node->num_keys; i++) {
+        printf(i ? " %llu" : "%llu", (unsigned long long)keys[i]);
+    }
+    printf("]");
+    if (node->type == OBELISK_NODE_BUFFERED) {
+        printf(" msgs=%u", as_buffered(node)->num_msgs);
+    }
+    printf("\n");
+
+    if (node->type != OBELISK_NODE_LEAF) {
+        for (uint32_t i = 0; i <= node->num_keys; i++) {
+            ObeliskNode* child = btree_child(tree, node, i);
+            if (!child) continue;
+            print_node(tree, child, depth + 1);
+            btree_release(tree, child);
+        }
+    }
 }
 
 void btree_print(ObeliskBTree* tree) {
-    // TODO: Implement tree printing for debugging
+    if (!tree) return;
+
+    printf("B+tree: height=%llu nodes=%llu\n",
+           (unsigned long long)tree->height, (unsigned long long)tree->num_nodes);
+    if (tree->root) {
+        print_node(tree, tree->root, 0);
+    }
+    btree_op_end(tree);
 }
 
-bool btree_validate(ObeliskBTree* tree) {
-    // TODO: Implement validation of B-tree properties
+// Leaves are told apart by something that survives their eviction: the page
+// id in a pool-backed tree, the address otherwise. 0 is no leaf.
+typedef struct {
+    uint64_t height;
+    uint64_t nodes;
+    uint64_t messages;
+    uint64_t prev_leaf;  // Last leaf seen
+    uint64_t prev_next;  // The leaf it links to next
+} ValidateState;
+
+static uint64_t node_identity(const ObeliskBTree* tree, const ObeliskNode* node) {
+    return tree->page_manager ? node->page_id : node_ref(node);
+}
+
+static uint64_t link_identity(const ObeliskBTree* tree, uint64_t ref) {
+    if (node_ref_is_page(ref)) return node_ref_page_id(ref);
+    return ref ? node_identity(tree, (const ObeliskNode*)(uintptr_t)ref) : 0;
+}
+
+// Keys of a subtree must lie in [lo, hi); has_lo/has_hi mark open bounds
+static bool validate_node(ObeliskBTree* tree, ObeliskNode* node, uint64_t lo, bool has_lo,
+                          uint64_t hi, bool has_hi, uint64_t depth, ValidateState* state) {
+    state->nodes++;
+    if (node->num_keys > node_max_keys(node)) return false;
+
+    const uint64_t* keys = node_keys(node);
+    for (uint32_t i = 0; i < node->num_keys; i++) {
+        if (i > 0 && keys[i - 1] >= keys[i]) return false;
+        if (has_lo && keys[i] < lo) return false;
+        if (has_hi && keys[i] >= hi) return false;
+    }
+
+    if (node->type == OBELISK_NODE_LEAF) {
+        if (depth != state->height) return false;
+
+        // Leaves must be chained in key order
+        uint64_t self = node_identity(tree, node);
+        if (link_identity(tree, node->prev_leaf) != state->prev_leaf) return false;
+        if (state->prev_leaf && state->prev_next != self) return false;
+        state->prev_leaf = self;
+        state->prev_next = link_identity(tree, node->next_leaf);
+        return true;
+    }
+
+    if (node->num_keys == 0) return false;
+
+    // Buffered messages obey the same bounds and are unique per key
+    if (node->type == OBELISK_NODE_BUFFERED) {
+        const ObeliskBufferedNode* buffered = as_buffered(node);
+        if (buffered->num_msgs > OBELISK_BTREE_BUFFER_CAPACITY) return false;
+        for (uint32_t i = 0; i < buffered->num_msgs; i++) {
+            uint64_t msg_key = buffered->msg_keys[i];
+            if (i > 0 && buffered->msg_keys[i - 1] >= msg_key) return false;
+            if (has_lo && msg_key < lo) return false;
+            if (has_hi && msg_key >= hi) return false;
+            if (buffered->msg_ops[i] > BTREE_MSG_DELETE) return false;
+        }
+        state->messages += buffered->num_msgs;
+    }
+
+    for (uint32_t i = 0; i <= node->num_keys; i++) {
+        bool child_has_lo = i > 0 ? true : has_lo;
+        uint64_t child_lo = i > 0 ? keys[i - 1] : lo;
+        bool child_has_hi = i < node->num_keys ? true : has_hi;
+        uint64_t child_hi = i < node->num_keys ? keys[i] : hi;
+
+        if (!node_children(node)[i]) return false;
+        ObeliskNode* child = btree_child(tree, node, i);
+        if (!child) return false;
+
+        // A swizzled child must know where its address is held
+        if (tree->evictable && child->parent != node) return false;
+        if (!validate_node(tree, child, child_lo, child_has_lo, child_hi, child_has_hi,
+                           depth + 1, state)) {
+            return false;
+        }
+        btree_release(tree, child);
+    }
     return true;
 }
 
+static bool validate_tree(ObeliskBTree* tree) {
+    if (!tree->root) return tree->height == 0 && tree->num_nodes == 0;
+
+    ValidateState state = { .height = tree->height, .nodes = 0, .messages = 0,
+                            .prev_leaf = 0, .prev_next = 0 };
+    if (!validate_node(tree, tree->root, 0, false, 0, false, 1, &state)) return false;
+    if (state.prev_leaf && state.prev_next) return false;
+
+    return state.nodes == tree->num_nodes && state.messages == tree->pending_messages;
+}
+
+bool btree_validate(ObeliskBTree* tree) {
+    if (!tree) return false;
+
+    bool valid = validate_tree(tree);
+    btree_op_end(tree);
+    return valid;
+}
+
+// An evictable tree keeps the iterator's leaf pinned between calls
+static void iterator_set_leaf(ObeliskBTreeIterator* iter, ObeliskNode* leaf) {
+    ObeliskBTree* tree = iter->tree;
+    if (tree->evictable) {
+        if (leaf) buffer_pool_pin_page(tree->page_manager, leaf->page_id);
+        if (iter->current_node) {
+            buffer_pool_unpin_page(tree->page_manager, iter->current_node->page_id, false);
+        }
+    }
+    iter->current_node = leaf;
+}
+
 ObeliskBTreeIterator* btree_iterator_create(ObeliskBTree* tree) {
     if (!tree) return NULL;
 
@@ -151,32 +1236,59 @@ ObeliskBTreeIterator* btree_iterator_create(ObeliskBTree* tree) {
     iter->current_node = NULL;
     iter->current_pos = 0;
 
+    // Leaves only reflect every update once the buffers are drained
+    if (tree->buffered && btree_buffered_drain(tree) != 0) {
+        free(iter);
+        return NULL;
+    }
+
     if (tree->root) {
         ObeliskNode* node = tree->root;
-        while (node->type == OBELISK_NODE_INTERNAL) {
-            node = (ObeliskNode*)(uintptr_t)node->children[0];
+        while (node && node->type != OBELISK_NODE_LEAF) {
+            node = btree_child(tree, node, 0);
         }
-        iter->current_node = node;
+        iterator_set_leaf(iter, node);
     }
 
+    btree_op_end(tree);
     return iter;
 }
 
+bool btree_iterator_seek(ObeliskBTreeIterator* iter, uint64_t key) {
+    if (!iter) return false;
+
+    ObeliskNode* leaf = find_leaf(iter->tree, key);
+    iterator_set_leaf(iter, leaf);
+    btree_op_end(iter->tree);
+    iter->current_pos = 0;
+    if (!leaf) return false;
+
+    // Keys < key are exactly the keys <= key - 1
+    iter->current_pos = key ? btree_node_upper_bound(node_keys(leaf), leaf->num_keys, key - 1) : 0;
+    return true;
+}
+
 bool btree_iterator_next(ObeliskBTreeIterator* iter, uint64_t* key, uint64_t* value) {
-    if (!iter || !iter->current_node) return false;
+    if (!iter) return false;
 
-    if (iter->current_pos >= iter->current_node->num_keys) {
-        // TODO: Implement traversal to next leaf node
-        return false;
+    // Follow sibling links instead of re-descending from the root
+    while (iter->current_node && (uint32_t)iter->current_pos >= iter->current_node->num_keys) {
+        iterator_set_leaf(iter, btree_next_leaf(iter->tree, iter->current_node));
+        iter->current_pos = 0;
     }
+    btree_op_end(iter->tree);
+    if (!iter->current_node) return false;
 
-    if (key) *key = iter->current_node->keys[iter->current_pos];
-    if (value) *value = iter->current_node->children[iter->current_pos];
+    ObeliskLeafNode* leaf = as_leaf(iter->current_node);
+    if (key) *key = leaf->keys[iter->current_pos];
+    if (value) *value = leaf->values[iter->current_pos];
     iter->current_pos++;
 
     return true;
 }
 
 void btree_iterator_destroy(ObeliskBTreeIterator* iter) {
+    if (!iter) return;
+    iterator_set_leaf(iter, NULL);
     free(iter);
-} 
\ No newline at end of file
+}
@@ -0,0 +1,307 @@
+#include "btree_internal.h"
+
+// Write-optimized B+tree paths in the style of a B-epsilon tree (Brodal and
+// Fagerberg; Bender et al., "An Introduction to Be-trees"). Updates are
+// queued as messages in the root's buffer. When a buffer fills, the messages
+// bound for its busiest child move down one level as a batch, so one write
+// to a leaf applies many updates at once. Each buffer holds at most one
+// message per key, and a message always overrides anything below it.
+
+// A node that needs a split by its parent before it can take any more
+enum {
+    FLUSH_OK = 0,
+    FLUSH_SPLIT = 1
+};
+
+// Index of the first message with a key >= key
+static uint32_t msg_lower_bound(const ObeliskBufferedNode* node, uint64_t key) {
+    uint32_t lo = 0;
+    uint32_t hi = node->num_msgs;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (node->msg_keys[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Messages [lo, hi) of node are bound for child slot
+static void child_msg_range(ObeliskNode* node, uint32_t slot, uint32_t* lo, uint32_t* hi) {
+    ObeliskBufferedNode* buffered = as_buffered(node);
+    const uint64_t* pivots = node_keys(node);
+    *lo = slot > 0 ? msg_lower_bound(buffered, pivots[slot - 1]) : 0;
+    *hi = slot < node->num_keys ? msg_lower_bound(buffered, pivots[slot]) : buffered->num_msgs;
+}
+
+static void buffer_remove(ObeliskBufferedNode* node, uint32_t lo, uint32_t hi) {
+    uint32_t tail = node->num_msgs - hi;
+    memmove(&node->msg_keys[lo], &node->msg_keys[hi], tail * sizeof(uint64_t));
+    memmove(&node->msg_values[lo], &node->msg_values[hi], tail * sizeof(uint64_t));
+    memmove(&node->msg_ops[lo], &node->msg_ops[hi], tail);
+    node->num_msgs -= hi - lo;
+    node->header.is_dirty = true;
+}
+
+// Queue a message in a buffer with room for it, replacing any older message
+// for the same key. Returns true if the buffer grew.
+static bool buffer_put(ObeliskBufferedNode* node, uint64_t key, uint64_t value, uint8_t op) {
+    uint32_t pos = msg_lower_bound(node, key);
+    node->header.is_dirty = true;
+    if (pos < node->num_msgs && node->msg_keys[pos] == key) {
+        node->msg_values[pos] = value;
+        node->msg_ops[pos] = op;
+        return false;
+    }
+
+    uint32_t tail = node->num_msgs - pos;
+    memmove(&node->msg_keys[pos + 1], &node->msg_keys[pos], tail * sizeof(uint64_t));
+    memmove(&node->msg_values[pos + 1], &node->msg_values[pos], tail * sizeof(uint64_t));
+    memmove(&node->msg_ops[pos + 1], &node->msg_ops[pos], tail);
+    node->msg_keys[pos] = key;
+    node->msg_values[pos] = value;
+    node->msg_ops[pos] = op;
+    node->num_msgs++;
+    return true;
+}
+
+// Apply a message to a leaf. Returns false if it is an insert of a new key
+// into a full leaf, which must be split first.
+static bool leaf_apply(ObeliskNode* leaf, uint64_t key, uint64_t value, uint8_t op) {
+    ObeliskLeafNode* entries = as_leaf(leaf);
+    uint32_t pos = btree_node_upper_bound(entries->keys, leaf->num_keys, key);
+    bool present = pos > 0 && entries->keys[pos - 1] == key;
+
+    if (op == BTREE_MSG_DELETE) {
+        if (present) btree_leaf_remove(leaf, pos - 1);
+        return true;
+    }
+    if (present) {
+        entries->values[pos - 1] = value;
+        leaf->is_dirty = true;
+        return true;
+    }
+    if (node_is_full(leaf)) return false;
+
+    btree_leaf_insert(leaf, pos, key, value);
+    return true;
+}
+
+// Apply messages [lo, hi) of node to its leaf children, splitting leaves
+// into node as they fill up
+static int flush_to_leaves(ObeliskBTree* tree, ObeliskNode* node, uint32_t lo, uint32_t hi) {
+    ObeliskBufferedNode* buffered = as_buffered(node);
+    int rc = FLUSH_OK;
+    uint32_t i = lo;
+
+    while (i < hi) {
+        uint64_t key = buffered->msg_keys[i];
+        uint32_t slot = btree_node_upper_bound(node_keys(node), node->num_keys, key);
+        ObeliskNode* leaf = btree_child(tree, node, slot);
+        if (!leaf) {
+            rc = -1;
+            break;
+        }
+
+        if (leaf_apply(leaf, key, buffered->msg_values[i], buffered->msg_ops[i])) {
+            btree_release(tree, leaf);
+            i++;
+            continue;
+        }
+        if (node_is_full(node)) break;  // The rest waits until node is split
+        if (btree_split_child(tree, node, (int)slot, leaf) != 0) {
+            rc = -1;
+            break;
+        }
+    }
+
+    buffer_remove(buffered, lo, i);
+    tree->pending_messages -= i - lo;
+    return rc;
+}
+
+// Move messages [lo, lo + count) of parent into the buffer of child, which
+// must have room for them. Newer messages from the parent win on equal keys.
+static void flush_to_buffer(ObeliskBTree* tree, ObeliskNode* parent, ObeliskNode* child,
+                            uint32_t lo, uint32_t count) {
+    ObeliskBufferedNode* src = as_buffered(parent);
+    ObeliskBufferedNode* dst = as_buffered(child);
+    uint64_t keys[OBELISK_BTREE_BUFFER_CAPACITY];
+    uint64_t values[OBELISK_BTREE_BUFFER_CAPACITY];
+    uint8_t ops[OBELISK_BTREE_BUFFER_CAPACITY];
+
+    uint32_t i = 0;
+    uint32_t j = lo;
+    uint32_t end = lo + count;
+    uint32_t n = 0;
+    while (i < dst->num_msgs || j < end) {
+        bool take_src = i == dst->num_msgs ||
+                        (j < end && src->msg_keys[j] <= dst->msg_keys[i]);
+        if (take_src) {
+            if (i < dst->num_msgs && dst->msg_keys[i] == src->msg_keys[j]) i++;
+            keys[n] = src->msg_keys[j];
+            values[n] = src->msg_values[j];
+            ops[n] = src->msg_ops[j];
+            j++;
+        } else {
+            keys[n] = dst->msg_keys[i];
+            values[n] = dst->msg_values[i];
+            ops[n] = dst->msg_ops[i];
+            i++;
+        }
+        n++;
+    }
+
+    tree->pending_messages -= dst->num_msgs + count - n;  // Overridden messages
+    memcpy(dst->msg_keys, keys, n * sizeof(uint64_t));
+    memcpy(dst->msg_values, values, n * sizeof(uint64_t));
+    memcpy(dst->msg_ops, ops, n);
+    dst->num_msgs = n;
+    child->is_dirty = true;
+
+    buffer_remove(src, lo, end);
+}
+
+// Push the messages bound for node's busiest child one level down. Returns
+// FLUSH_SPLIT if node itself is too full to absorb a child split.
+static int flush_node(ObeliskBTree* tree, ObeliskNode* node) {
+    if (node_is_full(node)) return FLUSH_SPLIT;
+
+    uint32_t slot = 0;
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    for (uint32_t i = 0; i <= node->num_keys; i++) {
+        uint32_t start, end;
+        child_msg_range(node, i, &start, &end);
+        if (end - start > hi - lo) {
+            slot = i;
+            lo = start;
+            hi = end;
+        }
+    }
+    if (lo == hi) return FLUSH_OK;
+
+    ObeliskNode* child = btree_child(tree, node, slot);
+    if (!child) return -1;
+    if (child->type == OBELISK_NODE_LEAF) return flush_to_leaves(tree, node, lo, hi);
+
+    // Make room below first; a child that cannot flush is split instead, and
+    // the caller comes back once the batch has a home again
+    int rc = FLUSH_OK;
+    if (as_buffered(child)->num_msgs == OBELISK_BTREE_BUFFER_CAPACITY) rc = flush_node(tree, child);
+    if (rc == FLUSH_SPLIT) {
+        rc = btree_split_child(tree, node, (int)slot, child);
+    } else if (rc == FLUSH_OK) {
+        uint32_t room = OBELISK_BTREE_BUFFER_CAPACITY - as_buffered(child)->num_msgs;
+        if (room > 0) flush_to_buffer(tree, node, child, lo, hi - lo < room ? hi - lo : room);
+    }
+
+    // A drain flushes through every child of node in turn
+    btree_release(tree, child);
+    return rc;
+}
+
+// Empty every buffer in node's subtree
+static int drain_node(ObeliskBTree* tree, ObeliskNode* node) {
+    while (as_buffered(node)->num_msgs > 0) {
+        int rc = flush_node(tree, node);
+        if (rc != FLUSH_OK) return rc;
+    }
+
+    uint32_t slot = 0;
+    while (slot <= node->num_keys) {
+        ObeliskNode* child = btree_child(tree, node, slot);
+        if (!child) return -1;
+        if (child->type == OBELISK_NODE_BUFFERED) {
+            int rc = drain_node(tree, child);
+            if (rc < 0) return rc;
+            if (rc == FLUSH_SPLIT) {
+                // Both halves are drained on the next passes over this slot
+                if (node_is_full(node)) return FLUSH_SPLIT;
+                if (btree_split_child(tree, node, (int)slot, child) != 0) return -1;
+                continue;
+            }
+        }
+        btree_release(tree, child);
+        slot++;
+    }
+    return FLUSH_OK;
+}
+
+static int buffered_put(ObeliskBTree* tree, uint64_t key, uint64_t value, uint8_t op) {
+    if (!tree->root) {
+        if (op == BTREE_MSG_DELETE) return 0;
+        ObeliskNode* root = btree_node_alloc(tree, OBELISK_NODE_LEAF);
+        if (!root) return -1;
+        btree_set_root(tree, root);
+        tree->height = 1;
+    }
+
+    // A lone leaf root is updated in place until it first splits
+    if (tree->root->type == OBELISK_NODE_LEAF) {
+        if (leaf_apply(tree->root, key, value, op)) return 0;
+        if (btree_grow_root(tree) != 0) return -1;
+    }
+
+    ObeliskNode* root = tree->root;
+    while (as_buffered(root)->num_msgs == OBELISK_BTREE_BUFFER_CAPACITY) {
+        int rc = flush_node(tree, root);
+        if (rc < 0) return -1;
+        if (rc == FLUSH_SPLIT) {
+            if (btree_grow_root(tree) != 0) return -1;
+            root = tree->root;
+        }
+    }
+
+    if (buffer_put(as_buffered(root), key, value, op)) tree->pending_messages++;
+    return 0;
+}
+
+int btree_buffered_search(ObeliskBTree* tree, uint64_t key, uint64_t* value) {
+    ObeliskNode* node = tree->root;
+    if (!node) return 0;
+
+    // The first message found on the way down is the newest for the key
+    while (node->type == OBELISK_NODE_BUFFERED) {
+        ObeliskBufferedNode* buffered = as_buffered(node);
+        uint32_t pos = msg_lower_bound(buffered, key);
+        if (pos < buffered->num_msgs && buffered->msg_keys[pos] == key) {
+            if (buffered->msg_ops[pos] == BTREE_MSG_DELETE) return 0;
+            if (value) *value = buffered->msg_values[pos];
+            return 1;
+        }
+
+        // A child the pool could not bring in is not evidence of absence
+        uint32_t slot = btree_node_upper_bound(node_keys(node), node->num_keys, key);
+        node = btree_child(tree, node, slot);
+        if (!node) return -1;
+    }
+
+    ObeliskLeafNode* leaf = as_leaf(node);
+    uint32_t pos = btree_node_upper_bound(leaf->keys, node->num_keys, key);
+    if (pos == 0 || leaf->keys[pos - 1] != key) return 0;
+
+    if (value) *value = leaf->values[pos - 1];
+    return 1;
+}
+
+int btree_buffered_insert(ObeliskBTree* tree, uint64_t key, uint64_t value) {
+    return buffered_put(tree, key, value, BTREE_MSG_INSERT);
+}
+
+int btree_buffered_delete(ObeliskBTree* tree, uint64_t key) {
+    return buffered_put(tree, key, 0, BTREE_MSG_DELETE);
+}
+
+int btree_buffered_drain(ObeliskBTree* tree) {
+    if (tree->pending_messages == 0) return 0;
+
+    for (;;) {
+        int rc = drain_node(tree, tree->root);
+        if (rc < 0) return -1;
+        if (rc == FLUSH_OK) return 0;
+        if (btree_grow_root(tree) != 0) return -1;
+    }
+}
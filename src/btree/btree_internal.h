@@ -0,0 +1,245 @@
+#ifndef OBELISK_BTREE_INTERNAL_H
+#define OBELISK_BTREE_INTERNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <obelisk/btree.h>
+
+#define BTREE_INNER_MAX_KEYS (OBELISK_BTREE_ORDER - 1)
+#define BTREE_LEAF_MAX_KEYS OBELISK_BTREE_LEAF_CAPACITY
+#define BTREE_BUFFERED_MAX_KEYS (OBELISK_BTREE_BUFFERED_FANOUT - 1)
+
+// Both layouts must fit a page, and keys must start right after the header
+// in each so searches can treat any node's keys the same way
+_Static_assert(sizeof(ObeliskNode) == OBELISK_BTREE_NODE_HEADER_SIZE, "node header must be one cache line");
+_Static_assert(sizeof(ObeliskInternalNode) <= OBELISK_PAGE_SIZE, "internal node exceeds a page");
+_Static_assert(sizeof(ObeliskLeafNode) <= OBELISK_PAGE_SIZE, "leaf node exceeds a page");
+_Static_assert(offsetof(ObeliskInternalNode, keys) == sizeof(ObeliskNode), "internal keys must follow the header");
+_Static_assert(offsetof(ObeliskLeafNode, keys) == sizeof(ObeliskNode), "leaf keys must follow the header");
+_Static_assert(sizeof(ObeliskBufferedNode) <= OBELISK_PAGE_SIZE, "buffered node exceeds a page");
+_Static_assert(offsetof(ObeliskBufferedNode, keys) == sizeof(ObeliskNode), "buffered keys must follow the header");
+_Static_assert(OBELISK_BTREE_BUFFER_CAPACITY >= OBELISK_BTREE_BUFFERED_FANOUT, "buffer too small to batch flushes");
+
+// Buffered message operations
+enum {
+    BTREE_MSG_INSERT = 0,
+    BTREE_MSG_DELETE = 1
+};
+
+static inline ObeliskLeafNode* as_leaf(ObeliskNode* node) {
+    return (ObeliskLeafNode*)node;
+}
+
+static inline ObeliskInternalNode* as_internal(ObeliskNode* node) {
+    return (ObeliskInternalNode*)node;
+}
+
+static inline ObeliskBufferedNode* as_buffered(ObeliskNode* node) {
+    return (ObeliskBufferedNode*)node;
+}
+
+static inline uint64_t* node_keys(ObeliskNode* node) {
+    return (uint64_t*)(node + 1);
+}
+
+// Node references, used for children and leaf sibling links. A reference
+// is swizzled, the node's address, while the node is resident, and holds its
+// page id tagged in the low bit otherwise; nodes are 64-byte aligned, so an
+// address never has that bit set. Only evictable trees hold page ids. 0 is
+// no node.
+#define NODE_REF_PAGE 1ull
+
+static inline bool node_ref_is_page(uint64_t ref) {
+    return (ref & NODE_REF_PAGE) != 0;
+}
+
+static inline uint64_t node_ref_from_page(uint64_t page_id) {
+    return page_id << 1 | NODE_REF_PAGE;
+}
+
+static inline uint64_t node_ref_page_id(uint64_t ref) {
+    return ref >> 1;
+}
+
+static inline uint64_t node_ref(const ObeliskNode* node) {
+    return (uint64_t)(uintptr_t)node;
+}
+
+// Child references of either internal layout
+static inline uint64_t* node_children(ObeliskNode* node) {
+    return node->type == OBELISK_NODE_BUFFERED ? as_buffered(node)->children
+                                               : as_internal(node)->children;
+}
+
+// Child of a tree whose references are always swizzled
+static inline ObeliskNode* node_child(ObeliskNode* node, uint32_t slot) {
+    return (ObeliskNode*)(uintptr_t)node_children(node)[slot];
+}
+
+// Every node an operation on an evictable tree reaches is stamped with the
+// tree's epoch, which keeps the pool from evicting it; the epoch moves on
+// when the operation returns. Walks over the whole tree release each
+// subtree once done with it, so they never hold more than a path.
+static inline void btree_touch(ObeliskBTree* tree, ObeliskNode* node) {
+    if (tree->evictable) node->epoch = tree->epoch;
+}
+
+static inline void btree_release(ObeliskBTree* tree, ObeliskNode* node) {
+    if (tree->evictable) node->epoch = tree->epoch - 1;
+}
+
+static inline void btree_op_end(ObeliskBTree* tree) {
+    if (tree->evictable) tree->epoch++;
+}
+
+// Swizzling (btree.c). Loading a child or sibling swizzles the reference
+// that led to it; loading by a bare reference swizzles nothing. Returns
+// NULL if the node cannot be brought in.
+ObeliskNode* btree_load_child(ObeliskBTree* tree, ObeliskNode* node, uint32_t slot);
+ObeliskNode* btree_next_leaf(ObeliskBTree* tree, ObeliskNode* leaf);
+ObeliskNode* btree_load_ref(ObeliskBTree* tree, uint64_t ref);
+
+static inline ObeliskNode* btree_child(ObeliskBTree* tree, ObeliskNode* node, uint32_t slot) {
+    uint64_t ref = node_children(node)[slot];
+    if (node_ref_is_page(ref)) return btree_load_child(tree, node, slot);
+
+    ObeliskNode* child = (ObeliskNode*)(uintptr_t)ref;
+    btree_touch(tree, child);
+    return child;
+}
+
+static inline uint32_t node_max_keys(const ObeliskNode* node) {
+    switch (node->type) {
+    case OBELISK_NODE_LEAF: return BTREE_LEAF_MAX_KEYS;
+    case OBELISK_NODE_BUFFERED: return BTREE_BUFFERED_MAX_KEYS;
+    default: return BTREE_INNER_MAX_KEYS;
+    }
+}
+
+// Intra-node key search. Returns the number of keys in the sorted array
+// keys[0..n) that are <= key, which is both the child slot to descend into
+// and one past the matching slot in a leaf.
+typedef uint32_t (*ObeliskKeySearchFn)(const uint64_t* keys, uint32_t n, uint64_t key);
+
+// Select the widest kernel the CPU supports (safe to call repeatedly)
+void btree_search_init(void);
+
+// Name of the kernel selected by btree_search_init ("avx512", "avx2", "sse4.2", "scalar")
+const char* btree_search_kernel_name(void);
+
+extern ObeliskKeySearchFn btree_key_search;
+
+static inline uint32_t btree_node_upper_bound(const uint64_t* keys, uint32_t n, uint64_t key) {
+    ObeliskKeySearchFn fn = __atomic_load_n(&btree_key_search, __ATOMIC_RELAXED);
+    return fn(keys, n, key);
+}
+
+static inline bool node_is_full(const ObeliskNode* node) {
+    return node->num_keys >= node_max_keys(node);
+}
+
+static inline void btree_leaf_insert(ObeliskNode* node, uint32_t pos, uint64_t key, uint64_t value) {
+    ObeliskLeafNode* leaf = as_leaf(node);
+    uint32_t tail = node->num_keys - pos;
+    memmove(&leaf->keys[pos + 1], &leaf->keys[pos], tail * sizeof(uint64_t));
+    memmove(&leaf->values[pos + 1], &leaf->values[pos], tail * sizeof(uint64_t));
+    leaf->keys[pos] = key;
+    leaf->values[pos] = value;
+    node->num_keys++;
+    node->is_dirty = true;
+}
+
+static inline void btree_leaf_remove(ObeliskNode* node, uint32_t pos) {
+    ObeliskLeafNode* leaf = as_leaf(node);
+    uint32_t tail = node->num_keys - pos - 1;
+    memmove(&leaf->keys[pos], &leaf->keys[pos + 1], tail * sizeof(uint64_t));
+    memmove(&leaf->values[pos], &leaf->values[pos + 1], tail * sizeof(uint64_t));
+    node->num_keys--;
+    node->is_dirty = true;
+}
+
+// Node memory (node_allocator.c). Heap nodes are carved from cache-line
+// aligned slabs; pool-backed nodes are buffer pool pages, handed out pinned.
+// Freed nodes are recycled through a free list, holding pool pages pinned,
+// and only released with the allocator. free_page instead recycles just the
+// page id of a node whose page has been dropped from the pool.
+ObeliskNodeAllocator* node_allocator_create(void* page_manager, size_t node_size);
+void node_allocator_destroy(ObeliskNodeAllocator* alloc);
+ObeliskNode* node_allocator_alloc(ObeliskNodeAllocator* alloc);
+void node_allocator_free(ObeliskNodeAllocator* alloc, ObeliskNode* node);
+void node_allocator_free_page(ObeliskNodeAllocator* alloc, uint64_t page_id);
+size_t node_allocator_memory_usage(ObeliskNodeAllocator* alloc);
+
+// Node lifecycle (btree.c)
+ObeliskNode* btree_node_alloc(ObeliskBTree* tree, ObeliskNodeType type);
+void btree_node_free(ObeliskBTree* tree, ObeliskNode* node);
+void btree_set_root(ObeliskBTree* tree, ObeliskNode* root);
+int btree_grow_root(ObeliskBTree* tree);
+
+// Optimistic lock coupling. A writer sets the locked bit with a CAS against
+// the version it read; unlocking adds the bit again, which clears it and
+// carries into the counter. Readers validate by re-reading the version.
+#define NODE_OBSOLETE 1ull
+#define NODE_LOCKED   2ull
+
+static inline void btree_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Wait out a writer and return the version; obsolete nodes force a restart
+static inline uint64_t node_read_lock(const ObeliskNode* node, bool* restart) {
+    uint64_t version = __atomic_load_n(&node->version, __ATOMIC_ACQUIRE);
+    while (version & NODE_LOCKED) {
+        btree_cpu_relax();
+        version = __atomic_load_n(&node->version, __ATOMIC_ACQUIRE);
+    }
+    if (version & NODE_OBSOLETE) *restart = true;
+    return version;
+}
+
+// True if nothing was written to the node since `version` was read
+static inline bool node_validate(const ObeliskNode* node, uint64_t version) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&node->version, __ATOMIC_RELAXED) == version;
+}
+
+static inline bool node_upgrade_lock(ObeliskNode* node, uint64_t version) {
+    return __atomic_compare_exchange_n(&node->version, &version, version + NODE_LOCKED,
+                                       false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+// num_keys may be mid-update under a reader; clamp it so searches stay inside the node
+static inline uint32_t node_key_count(const ObeliskNode* node) {
+    uint32_t n = __atomic_load_n(&node->num_keys, __ATOMIC_RELAXED);
+    uint32_t max = node_max_keys(node);
+    return n < max ? n : max;
+}
+
+static inline void node_write_unlock(ObeliskNode* node) {
+    __atomic_fetch_add(&node->version, NODE_LOCKED, __ATOMIC_RELEASE);
+}
+
+static inline void node_write_unlock_obsolete(ObeliskNode* node) {
+    __atomic_fetch_add(&node->version, NODE_LOCKED | NODE_OBSOLETE, __ATOMIC_RELEASE);
+}
+
+// Concurrent entry points (btree_olc.c)
+bool btree_olc_search(ObeliskBTree* tree, uint64_t key, uint64_t* value);
+int btree_olc_insert(ObeliskBTree* tree, uint64_t key, uint64_t value);
+int btree_olc_delete(ObeliskBTree* tree, uint64_t key);
+
+// Buffered (write-optimized) entry points (btree_buffered.c)
+int btree_buffered_search(ObeliskBTree* tree, uint64_t key, uint64_t* value);  // 1 found, 0 absent, -1 unreadable
+int btree_buffered_insert(ObeliskBTree* tree, uint64_t key, uint64_t value);
+int btree_buffered_delete(ObeliskBTree* tree, uint64_t key);
+int btree_buffered_drain(ObeliskBTree* tree);  // Apply every pending message to the leaves
+
+// Learned leaf index (btree_learned.c). Returns NULL when the model is stale
+// or cannot place key, in which case the caller descends normally.
+ObeliskNode* btree_learned_find_leaf(ObeliskBTree* tree, uint64_t key);
+size_t btree_learned_memory_usage(const ObeliskBTree* tree);
+
+#endif // OBELISK_BTREE_INTERNAL_H
@@ -0,0 +1,173 @@
+#include <stdlib.h>
+#include "btree_internal.h"
+
+// Learned leaf index in the spirit of FITing-tree and PGM-index. Each leaf
+// has a fence, the lower bound its parent separators give it, so the fences
+// route exactly the way a descent would. Fences only move when the structure
+// changes. Segments fitted with the shrinking-cone method predict a fence's
+// position within error leaves. The bounded search below then checks that
+// the fences it found really bracket the key, so a bad prediction can only
+// cost a fallback, never a wrong leaf. Leaves are held by reference, by page
+// id in an evictable tree, so evicting one leaves the model intact.
+
+typedef struct {
+    uint64_t first_key;  // Fence of the segment's first leaf
+    double slope;        // Leaves per unit of key space
+    uint32_t start;      // Position of the segment's first leaf
+} LearnedSegment;
+
+struct ObeliskLearnedIndex {
+    uint64_t smo_count;  // Tree structure version the model was built against
+    uint32_t error;
+    size_t num_leaves;
+    uint64_t* fences;
+    uint64_t* leaves;    // Leaf references
+    size_t num_segments;
+    LearnedSegment* segments;
+    size_t capacity;
+};
+
+static void learned_free(ObeliskLearnedIndex* index) {
+    if (!index) return;
+    free(index->fences);
+    free(index->leaves);
+    free(index->segments);
+    free(index);
+}
+
+static int collect_leaves(ObeliskBTree* tree, ObeliskLearnedIndex* index, ObeliskNode* node, uint64_t lo) {
+    if (node->type != OBELISK_NODE_LEAF) {
+        const uint64_t* keys = node_keys(node);
+        for (uint32_t i = 0; i <= node->num_keys; i++) {
+            ObeliskNode* child = btree_child(tree, node, i);
+            if (!child || collect_leaves(tree, index, child, i > 0 ? keys[i - 1] : lo) != 0) return -1;
+            btree_release(tree, child);
+        }
+        return 0;
+    }
+
+    if (index->num_leaves == index->capacity) {
+        size_t capacity = index->capacity ? index->capacity * 2 : 64;
+        uint64_t* fences = realloc(index->fences, capacity * sizeof(uint64_t));
+        if (!fences) return -1;
+        index->fences = fences;
+        uint64_t* leaves = realloc(index->leaves, capacity * sizeof(uint64_t));
+        if (!leaves) return -1;
+        index->leaves = leaves;
+        index->capacity = capacity;
+    }
+    index->fences[index->num_leaves] = lo;
+    index->leaves[index->num_leaves] = tree->evictable ? node_ref_from_page(node->page_id) : node_ref(node);
+    index->num_leaves++;
+    return 0;
+}
+
+// Greedy shrinking cone: extend a segment while some slope through its first
+// point keeps every fence within error of its position
+static int fit_segments(ObeliskLearnedIndex* index) {
+    size_t n = index->num_leaves;
+    index->segments = malloc((n ? n : 1) * sizeof(LearnedSegment));
+    if (!index->segments) return -1;
+
+    size_t i = 0;
+    while (i < n) {
+        uint64_t x0 = index->fences[i];
+        double lo_slope = 0.0;
+        double hi_slope = -1.0;  // Unbounded until a second point is seen
+        size_t j = i + 1;
+
+        for (; j < n; j++) {
+            if (index->fences[j] <= x0) break;
+            double dx = (double)(index->fences[j] - x0);
+            double dy = (double)(j - i);
+            double lo = (dy - index->error) / dx;
+            double hi = (dy + index->error) / dx;
+            double next_lo = lo > lo_slope ? lo : lo_slope;
+            double next_hi = hi_slope < 0.0 || hi < hi_slope ? hi : hi_slope;
+            if (next_lo > next_hi) break;
+            lo_slope = next_lo;
+            hi_slope = next_hi;
+        }
+
+        LearnedSegment* segment = &index->segments[index->num_segments++];
+        segment->first_key = x0;
+        segment->slope = hi_slope < 0.0 ? 0.0 : (lo_slope + hi_slope) / 2;
+        segment->start = (uint32_t)i;
+        i = j;
+    }
+    return 0;
+}
+
+static int build_index(ObeliskBTree* tree, uint32_t error_bound) {
+    ObeliskLearnedIndex* index = calloc(1, sizeof(ObeliskLearnedIndex));
+    if (!index) return -1;
+    index->smo_count = tree->smo_count;
+    index->error = error_bound;
+
+    if (tree->root && collect_leaves(tree, index, tree->root, 0) != 0) {
+        learned_free(index);
+        return -1;
+    }
+    if (index->num_leaves > UINT32_MAX || fit_segments(index) != 0) {
+        learned_free(index);
+        return -1;
+    }
+
+    btree_drop_learned_index(tree);
+    tree->learned = index;
+    return 0;
+}
+
+int btree_build_learned_index(ObeliskBTree* tree, uint32_t error_bound) {
+    if (!tree || tree->concurrent || tree->buffered) return -1;
+
+    int rc = build_index(tree, error_bound);
+    btree_op_end(tree);
+    return rc;
+}
+
+void btree_drop_learned_index(ObeliskBTree* tree) {
+    if (!tree) return;
+    learned_free(tree->learned);
+    tree->learned = NULL;
+}
+
+ObeliskNode* btree_learned_find_leaf(ObeliskBTree* tree, uint64_t key) {
+    const ObeliskLearnedIndex* index = tree->learned;
+    if (!index || index->smo_count != tree->smo_count || index->num_leaves == 0) return NULL;
+
+    // Last segment starting at or before key; the first starts at fence 0
+    size_t lo = 0;
+    size_t hi = index->num_segments;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->segments[mid].first_key <= key) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    const LearnedSegment* segment = &index->segments[lo];
+
+    double predicted = segment->start + segment->slope * (double)(key - segment->first_key);
+    size_t n = index->num_leaves;
+    size_t pos = predicted < (double)n ? (size_t)predicted : n - 1;
+
+    // One extra slot on each side covers keys between two fences and rounding
+    size_t reach = (size_t)index->error + 1;
+    size_t first = pos > reach ? pos - reach : 0;
+    size_t last = pos + reach + 1 < n ? pos + reach + 1 : n;
+
+    uint32_t count = btree_node_upper_bound(&index->fences[first], (uint32_t)(last - first), key);
+    if (count == 0) return NULL;  // Key's fence lies left of the window
+    if (first + count == last && last < n && index->fences[last] <= key) return NULL;
+
+    return btree_load_ref(tree, index->leaves[first + count - 1]);
+}
+
+size_t btree_learned_memory_usage(const ObeliskBTree* tree) {
+    const ObeliskLearnedIndex* index = tree->learned;
+    if (!index) return 0;
+    return sizeof(*index) + index->capacity * 2 * sizeof(uint64_t) +
+           index->num_leaves * sizeof(LearnedSegment);
+}
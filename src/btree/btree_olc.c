@@ -0,0 +1,187 @@
+#include "btree_internal.h"
+
+// Concurrent B+tree paths using optimistic lock coupling (Leis et al.,
+// "The ART of Practical Synchronization"). Readers never write shared
+// memory; they validate each node's version after reading from it and
+// restart from the root if anything changed. Full nodes are split eagerly
+// on the way down, so a writer latches at most a parent and one child, plus
+// the leaf after the child when that child is a leaf being split.
+
+static inline ObeliskNode* load_root(ObeliskBTree* tree) {
+    return __atomic_load_n(&tree->root, __ATOMIC_ACQUIRE);
+}
+
+static inline ObeliskNode* child_at(ObeliskNode* node, uint32_t slot) {
+    return (ObeliskNode*)(uintptr_t)__atomic_load_n(&as_internal(node)->children[slot], __ATOMIC_RELAXED);
+}
+
+// Latch the leaf after a full leaf, whose back link its split rewrites.
+// Returns false, without waiting, if another writer holds it.
+static bool latch_next_leaf(ObeliskNode* leaf, ObeliskNode** next) {
+    *next = leaf->type == OBELISK_NODE_LEAF ? (ObeliskNode*)(uintptr_t)leaf->next_leaf : NULL;
+    if (!*next) return true;
+
+    uint64_t version = __atomic_load_n(&(*next)->version, __ATOMIC_ACQUIRE);
+    return !(version & (NODE_LOCKED | NODE_OBSOLETE)) && node_upgrade_lock(*next, version);
+}
+
+// Descend to the leaf covering key; returns it with the version it was read at
+static ObeliskNode* find_leaf(ObeliskBTree* tree, uint64_t key, uint64_t* leaf_version) {
+restart:;
+    bool restart = false;
+    ObeliskNode* node = load_root(tree);
+    if (!node) return NULL;
+
+    uint64_t version = node_read_lock(node, &restart);
+    if (restart || node != load_root(tree)) goto restart;
+
+    while (node->type == OBELISK_NODE_INTERNAL) {
+        uint32_t slot = btree_node_upper_bound(node_keys(node), node_key_count(node), key);
+        ObeliskNode* child = child_at(node, slot);
+        if (!node_validate(node, version)) goto restart;
+
+        uint64_t child_version = node_read_lock(child, &restart);
+        if (restart || !node_validate(node, version)) goto restart;
+
+        node = child;
+        version = child_version;
+    }
+
+    *leaf_version = version;
+    return node;
+}
+
+bool btree_olc_search(ObeliskBTree* tree, uint64_t key, uint64_t* value) {
+    for (;;) {
+        uint64_t version;
+        ObeliskNode* leaf = find_leaf(tree, key, &version);
+        if (!leaf) return false;
+
+        ObeliskLeafNode* entries = as_leaf(leaf);
+        uint32_t pos = btree_node_upper_bound(entries->keys, node_key_count(leaf), key);
+        bool found = pos > 0 && entries->keys[pos - 1] == key;
+        uint64_t result = found ? entries->values[pos - 1] : 0;
+        if (!node_validate(leaf, version)) continue;
+
+        if (found && value) *value = result;
+        return found;
+    }
+}
+
+// First insert into an empty tree races other writers to install the root
+static int install_root(ObeliskBTree* tree, uint64_t key, uint64_t value) {
+    ObeliskNode* leaf = btree_node_alloc(tree, OBELISK_NODE_LEAF);
+    if (!leaf) return -1;
+
+    btree_leaf_insert(leaf, 0, key, value);
+
+    ObeliskNode* expected = NULL;
+    if (__atomic_compare_exchange_n(&tree->root, &expected, leaf, false,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&tree->height, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    btree_node_free(tree, leaf);
+    return 1;  // Lost the race; retry against the new root
+}
+
+int btree_olc_insert(ObeliskBTree* tree, uint64_t key, uint64_t value) {
+restart:;
+    bool restart = false;
+    ObeliskNode* node = load_root(tree);
+    if (!node) {
+        int rc = install_root(tree, key, value);
+        if (rc <= 0) return rc;
+        goto restart;
+    }
+
+    uint64_t version = node_read_lock(node, &restart);
+    if (restart || node != load_root(tree)) goto restart;
+
+    ObeliskNode* parent = NULL;
+    uint64_t parent_version = 0;
+    uint32_t slot = 0;
+
+    for (;;) {
+        if (node_is_full(node)) {
+            // Split eagerly, latching parent before child, then start over
+            if (parent && !node_upgrade_lock(parent, parent_version)) goto restart;
+            if (!node_upgrade_lock(node, version)) {
+                if (parent) node_write_unlock(parent);
+                goto restart;
+            }
+            if (!parent && node != load_root(tree)) {
+                node_write_unlock(node);
+                goto restart;
+            }
+            ObeliskNode* next;
+            if (!latch_next_leaf(node, &next)) {
+                node_write_unlock(node);
+                if (parent) node_write_unlock(parent);
+                goto restart;
+            }
+
+            int rc = parent ? btree_split_child(tree, parent, (int)slot, node)
+                            : btree_grow_root(tree);
+            if (next) node_write_unlock(next);
+            node_write_unlock(node);
+            if (parent) node_write_unlock(parent);
+            if (rc != 0) return -1;
+            goto restart;
+        }
+
+        if (node->type == OBELISK_NODE_LEAF) break;
+
+        uint32_t child_slot = btree_node_upper_bound(node_keys(node), node_key_count(node), key);
+        ObeliskNode* child = child_at(node, child_slot);
+        if (!node_validate(node, version)) goto restart;
+
+        // Re-check the node so the child cannot have been split away meanwhile
+        uint64_t child_version = node_read_lock(child, &restart);
+        if (restart || !node_validate(node, version)) goto restart;
+
+        parent = node;
+        parent_version = version;
+        slot = child_slot;
+        node = child;
+        version = child_version;
+    }
+
+    // A leaf's key range only changes through writes to the leaf itself, so
+    // holding its latch at the version read during descent is sufficient
+    if (!node_upgrade_lock(node, version)) goto restart;
+
+    ObeliskLeafNode* leaf = as_leaf(node);
+    uint32_t pos = btree_node_upper_bound(leaf->keys, node->num_keys, key);
+    if (pos > 0 && leaf->keys[pos - 1] == key) {
+        leaf->values[pos - 1] = value;
+        node->is_dirty = true;
+    } else {
+        btree_leaf_insert(node, pos, key, value);
+    }
+
+    node_write_unlock(node);
+    return 0;
+}
+
+int btree_olc_delete(ObeliskBTree* tree, uint64_t key) {
+    for (;;) {
+        uint64_t version;
+        ObeliskNode* leaf = find_leaf(tree, key, &version);
+        if (!leaf) return -1;
+
+        // Check for the key optimistically so misses never latch the leaf
+        uint32_t pos = btree_node_upper_bound(node_keys(leaf), node_key_count(leaf), key);
+        bool found = pos > 0 && node_keys(leaf)[pos - 1] == key;
+        if (!found) {
+            if (!node_validate(leaf, version)) continue;
+            return -1;
+        }
+
+        if (!node_upgrade_lock(leaf, version)) continue;
+        btree_leaf_remove(leaf, pos - 1);
+        node_write_unlock(leaf);
+        return 0;
+    }
+}
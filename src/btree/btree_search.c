@@ -0,0 +1,130 @@
+#include <pthread.h>
+#include "btree_internal.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define OBELISK_HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// Branchless binary search: the compare feeds a conditional move rather than
+// a branch, so the cost is log2(n) dependent loads with no mispredictions.
+static uint32_t upper_bound_scalar(const uint64_t* keys, uint32_t n, uint64_t key) {
+    if (n == 0) return 0;
+
+    const uint64_t* base = keys;
+    uint32_t len = n;
+    while (len > 1) {
+        uint32_t half = len / 2;
+        base = (base[half - 1] <= key) ? base + half : base;
+        len -= half;
+    }
+    return (uint32_t)(base - keys) + (*base <= key);
+}
+
+#ifdef OBELISK_HAVE_X86_SIMD
+
+// A linear vector scan over a full node loses to the binary search above, so
+// the vector kernels binary-search down to one cache line of keys and only
+// compare that window. Keys are sorted, so the answer is the window's start
+// plus the number of window keys <= key. For n >= 8 the window is always
+// exactly 8 keys, pulled back from the end of the array when needed: keys
+// before it are all <= key and keys after it are all > key.
+#define SEARCH_WINDOW 8
+
+static const uint64_t* search_window(const uint64_t* keys, uint32_t n, uint64_t key) {
+    const uint64_t* base = keys;
+    uint32_t len = n;
+    while (len > SEARCH_WINDOW) {
+        uint32_t half = len / 2;
+        base = (base[half - 1] <= key) ? base + half : base;
+        len -= half;
+    }
+    return base + SEARCH_WINDOW <= keys + n ? base : keys + n - SEARCH_WINDOW;
+}
+
+// SSE/AVX2 only have signed 64-bit compares, so both sides are biased by
+// 2^63 to get unsigned ordering.
+
+__attribute__((target("sse4.2")))
+static uint32_t upper_bound_sse42(const uint64_t* keys, uint32_t n, uint64_t key) {
+    if (n < SEARCH_WINDOW) return upper_bound_scalar(keys, n, key);
+
+    const uint64_t* w = search_window(keys, n, key);
+    const __m128i bias = _mm_set1_epi64x(INT64_MIN);
+    const __m128i needle = _mm_xor_si128(_mm_set1_epi64x((int64_t)key), bias);
+
+    int gt = 0;
+    for (int i = 0; i < SEARCH_WINDOW; i += 2) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(w + i)), bias);
+        gt |= _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(v, needle))) << i;
+    }
+    return (uint32_t)(w - keys) + SEARCH_WINDOW - (uint32_t)__builtin_popcount(gt);
+}
+
+__attribute__((target("avx2")))
+static uint32_t upper_bound_avx2(const uint64_t* keys, uint32_t n, uint64_t key) {
+    if (n < SEARCH_WINDOW) return upper_bound_scalar(keys, n, key);
+
+    const uint64_t* w = search_window(keys, n, key);
+    const __m256i bias = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i needle = _mm256_xor_si256(_mm256_set1_epi64x((int64_t)key), bias);
+
+    __m256i lo = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)w), bias);
+    __m256i hi = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(w + 4)), bias);
+    int gt = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(lo, needle))) |
+             _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(hi, needle))) << 4;
+    return (uint32_t)(w - keys) + SEARCH_WINDOW - (uint32_t)__builtin_popcount(gt);
+}
+
+__attribute__((target("avx512f")))
+static uint32_t upper_bound_avx512(const uint64_t* keys, uint32_t n, uint64_t key) {
+    const __m512i needle = _mm512_set1_epi64((long long)key);
+
+    if (n < SEARCH_WINDOW) {
+        // Masked load covers a short node without touching memory past keys[n-1]
+        __mmask8 valid = (__mmask8)((1u << n) - 1);
+        __m512i v = _mm512_maskz_loadu_epi64(valid, keys);
+        return (uint32_t)__builtin_popcount(_mm512_mask_cmple_epu64_mask(valid, v, needle));
+    }
+
+    const uint64_t* w = search_window(keys, n, key);
+    __m512i v = _mm512_loadu_si512((const void*)w);
+    return (uint32_t)(w - keys) + (uint32_t)__builtin_popcount(_mm512_cmple_epu64_mask(v, needle));
+}
+
+#endif // OBELISK_HAVE_X86_SIMD
+
+ObeliskKeySearchFn btree_key_search = upper_bound_scalar;
+static const char* kernel_name = "scalar";
+static pthread_once_t search_once = PTHREAD_ONCE_INIT;
+
+static void select_kernel(void) {
+    ObeliskKeySearchFn fn = upper_bound_scalar;
+    const char* name = "scalar";
+
+#ifdef OBELISK_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        fn = upper_bound_avx512;
+        name = "avx512";
+    } else if (__builtin_cpu_supports("avx2")) {
+        fn = upper_bound_avx2;
+        name = "avx2";
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        fn = upper_bound_sse42;
+        name = "sse4.2";
+    }
+#endif
+
+    kernel_name = name;
+    __atomic_store_n(&btree_key_search, fn, __ATOMIC_RELEASE);
+}
+
+void btree_search_init(void) {
+    pthread_once(&search_once, select_kernel);
+}
+
+const char* btree_search_kernel_name(void) {
+    btree_search_init();
+    return kernel_name;
+}
@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <obelisk/buffer_pool.h>
+#include "btree_internal.h"
+
+#define NODE_ALIGNMENT 64
+#define NODES_PER_SLAB 256
+
+// Freed nodes are chained through the word after the version, which is left
+// untouched so optimistic readers holding a stale pointer still fail validation
+#define FREE_LINK(node) (*(ObeliskNode**)((char*)(node) + sizeof(uint64_t)))
+
+typedef struct ObeliskNodeSlab {
+    struct ObeliskNodeSlab* next;
+    void* memory;
+} ObeliskNodeSlab;
+
+struct ObeliskNodeAllocator {
+    pthread_mutex_t lock;
+    void* page_manager;  // Pages come from the buffer pool when set, else from slabs
+    size_t node_size;    // Rounded up to a whole number of cache lines
+
+    ObeliskNodeSlab* slabs;
+    char* bump;          // Next unused node in the newest slab
+    size_t bump_left;
+
+    ObeliskNode* free_list;
+    uint64_t slab_count;
+
+    // Pages of freed nodes already dropped from the pool, reused by id
+    uint64_t* free_pages;
+    size_t free_page_count;
+    size_t free_page_capacity;
+};
+
+ObeliskNodeAllocator* node_allocator_create(void* page_manager, size_t node_size) {
+    ObeliskNodeAllocator* alloc = malloc(sizeof(ObeliskNodeAllocator));
+    if (!alloc) return NULL;
+
+    if (pthread_mutex_init(&alloc->lock, NULL) != 0) {
+        free(alloc);
+        return NULL;
+    }
+
+    alloc->page_manager = page_manager;
+    alloc->node_size = (node_size + NODE_ALIGNMENT - 1) & ~(size_t)(NODE_ALIGNMENT - 1);
+    alloc->slabs = NULL;
+    alloc->bump = NULL;
+    alloc->bump_left = 0;
+    alloc->free_list = NULL;
+    alloc->slab_count = 0;
+    alloc->free_pages = NULL;
+    alloc->free_page_count = 0;
+    alloc->free_page_capacity = 0;
+    return alloc;
+}
+
+void node_allocator_destroy(ObeliskNodeAllocator* alloc) {
+    if (!alloc) return;
+
+    if (alloc->page_manager) {
+        // Recycled pages are still pinned by the allocator
+        for (ObeliskNode* node = alloc->free_list; node; node = FREE_LINK(node)) {
+            buffer_pool_unpin_page(alloc->page_manager, node->page_id, false);
+            buffer_pool_delete_page(alloc->page_manager, node->page_id);
+        }
+    }
+
+    // Every heap node lives in a slab, so this releases the whole tree
+    ObeliskNodeSlab* slab = alloc->slabs;
+    while (slab) {
+        ObeliskNodeSlab* next = slab->next;
+        free(slab->memory);
+        free(slab);
+        slab = next;
+    }
+
+    free(alloc->free_pages);
+    pthread_mutex_destroy(&alloc->lock);
+    free(alloc);
+}
+
+static ObeliskNode* alloc_from_slab(ObeliskNodeAllocator* alloc) {
+    if (alloc->bump_left == 0) {
+        ObeliskNodeSlab* slab = malloc(sizeof(ObeliskNodeSlab));
+        if (!slab) return NULL;
+
+        slab->memory = aligned_alloc(NODE_ALIGNMENT, alloc->node_size * NODES_PER_SLAB);
+        if (!slab->memory) {
+            free(slab);
+            return NULL;
+        }
+
+        slab->next = alloc->slabs;
+        alloc->slabs = slab;
+        alloc->bump = slab->memory;
+        alloc->bump_left = NODES_PER_SLAB;
+        alloc->slab_count++;
+    }
+
+    ObeliskNode* node = (ObeliskNode*)alloc->bump;
+    alloc->bump += alloc->node_size;
+    alloc->bump_left--;
+
+    node->version = 0;
+    node->page_id = 0;
+    return node;
+}
+
+static ObeliskNode* alloc_from_pool(ObeliskNodeAllocator* alloc, uint64_t page_id) {
+    // Handed out pinned; only an evictable tree drops the pin while it uses the node
+    ObeliskBufferPool* pool = alloc->page_manager;
+    ObeliskPage* page = page_id ? buffer_pool_fetch_page_class(pool, page_id, OBELISK_PAGE_CLASS_INDEX)
+                                : buffer_pool_new_page(pool, &page_id);
+    if (!page) return NULL;
+    page->page_class = OBELISK_PAGE_CLASS_INDEX;
+
+    ObeliskNode* node = page->data;
+    node->version = 0;
+    node->page_id = page_id;
+    return node;
+}
+
+ObeliskNode* node_allocator_alloc(ObeliskNodeAllocator* alloc) {
+    pthread_mutex_lock(&alloc->lock);
+
+    ObeliskNode* node = alloc->free_list;
+    uint64_t page_id = 0;
+    if (node) {
+        alloc->free_list = FREE_LINK(node);
+    } else if (!alloc->page_manager) {
+        node = alloc_from_slab(alloc);
+    } else if (alloc->free_page_count > 0) {
+        page_id = alloc->free_pages[--alloc->free_page_count];
+    }
+
+    pthread_mutex_unlock(&alloc->lock);
+
+    if (!node && alloc->page_manager) {
+        node = alloc_from_pool(alloc, page_id);
+        if (!node && page_id) node_allocator_free_page(alloc, page_id);
+    }
+    return node;
+}
+
+void node_allocator_free(ObeliskNodeAllocator* alloc, ObeliskNode* node) {
+    pthread_mutex_lock(&alloc->lock);
+    FREE_LINK(node) = alloc->free_list;
+    alloc->free_list = node;
+    pthread_mutex_unlock(&alloc->lock);
+}
+
+void node_allocator_free_page(ObeliskNodeAllocator* alloc, uint64_t page_id) {
+    pthread_mutex_lock(&alloc->lock);
+    if (alloc->free_page_count == alloc->free_page_capacity) {
+        size_t capacity = alloc->free_page_capacity ? alloc->free_page_capacity * 2 : 64;
+        uint64_t* pages = realloc(alloc->free_pages, capacity * sizeof(uint64_t));
+        if (!pages) {
+            pthread_mutex_unlock(&alloc->lock);
+            return;  // The page is simply never reused
+        }
+        alloc->free_pages = pages;
+        alloc->free_page_capacity = capacity;
+    }
+    alloc->free_pages[alloc->free_page_count++] = page_id;
+    pthread_mutex_unlock(&alloc->lock);
+}
+
+size_t node_allocator_memory_usage(ObeliskNodeAllocator* alloc) {
+    if (!alloc) return 0;
+
+    pthread_mutex_lock(&alloc->lock);
+    size_t bytes = alloc->slab_count * alloc->node_size * NODES_PER_SLAB;
+    pthread_mutex_unlock(&alloc->lock);
+    return bytes;
+}
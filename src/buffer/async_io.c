@@ -0,0 +1,507 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "async_io.h"
+
+#define ASYNC_IO_WORKERS 4
+
+typedef struct IORequest {
+    struct iovec iov;
+    off_t offset;
+    uint64_t tag;
+    ssize_t result;
+    bool write;
+    ObeliskAsyncIO* owner;
+    uint32_t slot;
+    struct IORequest* next;       // Next waiting for a worker
+} IORequest;
+
+// Worker threads of the thread-pool backend, shared by every instance
+// created from the first, so the thread count does not grow with them
+typedef struct {
+    pthread_t threads[ASYNC_IO_WORKERS];
+    unsigned num_threads;
+    unsigned refs;                // Instances using the pool
+    pthread_mutex_t lock;         // Also guards each instance's done ring
+    pthread_cond_t work_ready;
+    IORequest* work_head;         // Requests waiting for a worker, oldest first
+    IORequest* work_tail;
+    bool stopping;
+} WorkerPool;
+
+typedef enum {
+    BACKEND_URING,
+    BACKEND_THREADS
+} BackendKind;
+
+struct ObeliskAsyncIO {
+    int fd;
+    unsigned depth;
+    BackendKind kind;
+
+    // Request slots; a slot is busy from queue until reap
+    IORequest* requests;
+    uint32_t* free_slots;
+    unsigned free_count;
+
+    // Slots queued but not yet submitted
+    uint32_t* staged;
+    unsigned staged_count;
+
+    // io_uring rings, mapped from the kernel
+    int ring_fd;
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+
+    // Thread pool, and the slots its workers finished for this instance,
+    // a ring of depth entries
+    WorkerPool* workers;
+    pthread_cond_t work_done;
+    uint32_t* done;
+    unsigned done_head;
+    unsigned done_count;
+    bool stopping;
+};
+
+// io_uring through raw system calls, so there is no liburing dependency
+
+static int uring_setup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static void uring_unmap(ObeliskAsyncIO* aio) {
+    if (aio->sqes) munmap(aio->sqes, aio->sqes_size);
+    if (aio->cq_ring && aio->cq_ring != aio->sq_ring) munmap(aio->cq_ring, aio->cq_ring_size);
+    if (aio->sq_ring) munmap(aio->sq_ring, aio->sq_ring_size);
+    if (aio->ring_fd >= 0) close(aio->ring_fd);
+    aio->sqes = NULL;
+    aio->cq_ring = NULL;
+    aio->sq_ring = NULL;
+    aio->ring_fd = -1;
+}
+
+// A ring made with share_fd hands blocking work to the same kernel worker
+// threads as that ring, where the kernel supports it
+static int uring_init(ObeliskAsyncIO* aio, int share_fd) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    if (share_fd >= 0) {
+        params.flags = IORING_SETUP_ATTACH_WQ;
+        params.wq_fd = (uint32_t)share_fd;
+    }
+
+    aio->ring_fd = uring_setup(aio->depth, &params);
+    if (aio->ring_fd < 0 && share_fd >= 0) {
+        memset(&params, 0, sizeof(params));
+        aio->ring_fd = uring_setup(aio->depth, &params);
+    }
+    if (aio->ring_fd < 0) return -1;
+
+    aio->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    aio->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap && aio->cq_ring_size > aio->sq_ring_size) {
+        aio->sq_ring_size = aio->cq_ring_size;
+    }
+
+    aio->sq_ring = mmap(NULL, aio->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        aio->ring_fd, IORING_OFF_SQ_RING);
+    if (aio->sq_ring == MAP_FAILED) {
+        aio->sq_ring = NULL;
+        uring_unmap(aio);
+        return -1;
+    }
+
+    if (single_mmap) {
+        aio->cq_ring = aio->sq_ring;
+    } else {
+        aio->cq_ring = mmap(NULL, aio->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            aio->ring_fd, IORING_OFF_CQ_RING);
+        if (aio->cq_ring == MAP_FAILED) {
+            aio->cq_ring = NULL;
+            uring_unmap(aio);
+            return -1;
+        }
+    }
+
+    aio->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    aio->sqes = mmap(NULL, aio->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     aio->ring_fd, IORING_OFF_SQES);
+    if (aio->sqes == MAP_FAILED) {
+        aio->sqes = NULL;
+        uring_unmap(aio);
+        return -1;
+    }
+
+    char* sq = aio->sq_ring;
+    char* cq = aio->cq_ring;
+    aio->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    aio->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    aio->sq_array = (unsigned*)(sq + params.sq_off.array);
+    aio->cq_head = (unsigned*)(cq + params.cq_off.head);
+    aio->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    aio->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    aio->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // The kernel may round the ring up; never keep more in flight than asked
+    if (params.sq_entries < aio->depth) aio->depth = params.sq_entries;
+    return 0;
+}
+
+static int uring_submit(ObeliskAsyncIO* aio) {
+    if (aio->staged_count == 0) return 0;
+
+    unsigned tail = *aio->sq_tail;
+    unsigned mask = *aio->sq_mask;
+    for (unsigned i = 0; i < aio->staged_count; i++) {
+        uint32_t slot = aio->staged[i];
+        IORequest* request = &aio->requests[slot];
+        unsigned index = tail & mask;
+
+        struct io_uring_sqe* sqe = &aio->sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = request->write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe->fd = aio->fd;
+        sqe->addr = (uint64_t)(uintptr_t)&request->iov;
+        sqe->len = 1;
+        sqe->off = (uint64_t)request->offset;
+        sqe->user_data = slot;
+
+        aio->sq_array[index] = index;
+        tail++;
+    }
+    __atomic_store_n(aio->sq_tail, tail, __ATOMIC_RELEASE);
+
+    unsigned remaining = aio->staged_count;
+    while (remaining > 0) {
+        int submitted = uring_enter(aio->ring_fd, remaining, 0, 0);
+        if (submitted < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            return -1;
+        }
+        remaining -= (unsigned)submitted;
+    }
+    aio->staged_count = 0;
+    return 0;
+}
+
+static size_t uring_reap(ObeliskAsyncIO* aio, ObeliskIOCompletion* out, size_t max, bool wait) {
+    size_t count = 0;
+    for (;;) {
+        unsigned head = *aio->cq_head;
+        unsigned tail = __atomic_load_n(aio->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail && count < max) {
+            struct io_uring_cqe* cqe = &aio->cqes[head & *aio->cq_mask];
+            uint32_t slot = (uint32_t)cqe->user_data;
+            out[count].tag = aio->requests[slot].tag;
+            out[count].result = cqe->res;
+            aio->free_slots[aio->free_count++] = slot;
+            count++;
+            head++;
+        }
+        __atomic_store_n(aio->cq_head, head, __ATOMIC_RELEASE);
+
+        if (count > 0 || !wait || aio->free_count == aio->depth) return count;
+        if (uring_enter(aio->ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            return count;
+        }
+    }
+}
+
+// Thread pool fallback
+
+static ssize_t blocking_io(int fd, IORequest* request) {
+    char* buf = request->iov.iov_base;
+    size_t len = request->iov.iov_len;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = request->write
+            ? pwrite(fd, buf + done, len - done, request->offset + (off_t)done)
+            : pread(fd, buf + done, len - done, request->offset + (off_t)done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -errno;
+        }
+        if (n == 0) break;  // End of file
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+static void* worker_main(void* arg) {
+    WorkerPool* pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->work_head && !pool->stopping) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        IORequest* request = pool->work_head;
+        if (!request) break;
+
+        pool->work_head = request->next;
+        if (!pool->work_head) pool->work_tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        ObeliskAsyncIO* aio = request->owner;
+        request->result = blocking_io(aio->fd, request);
+
+        pthread_mutex_lock(&pool->lock);
+        aio->done[(aio->done_head + aio->done_count) % aio->depth] = request->slot;
+        aio->done_count++;
+        pthread_cond_signal(&aio->work_done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void workers_stop(WorkerPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    free(pool);
+}
+
+static WorkerPool* workers_create(void) {
+    WorkerPool* pool = calloc(1, sizeof(WorkerPool));
+    if (!pool) return NULL;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+
+    for (unsigned i = 0; i < ASYNC_IO_WORKERS; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0) break;
+        pool->num_threads++;
+    }
+    if (pool->num_threads == 0) {
+        workers_stop(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+// Join share's worker pool, or start one when share is NULL
+static int threads_init(ObeliskAsyncIO* aio, ObeliskAsyncIO* share) {
+    aio->done = malloc(aio->depth * sizeof(uint32_t));
+    if (!aio->done) return -1;
+
+    if (share) {
+        aio->workers = share->workers;
+        pthread_mutex_lock(&aio->workers->lock);
+        aio->workers->refs++;
+        pthread_mutex_unlock(&aio->workers->lock);
+        return 0;
+    }
+    aio->workers = workers_create();
+    if (!aio->workers) return -1;
+    aio->workers->refs = 1;
+    return 0;
+}
+
+// Leave the worker pool; the last instance out stops it
+static void threads_release(ObeliskAsyncIO* aio) {
+    WorkerPool* pool = aio->workers;
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    bool last = --pool->refs == 0;
+    pthread_mutex_unlock(&pool->lock);
+    if (last) workers_stop(pool);
+    aio->workers = NULL;
+}
+
+static int threads_submit(ObeliskAsyncIO* aio) {
+    if (aio->staged_count == 0) return 0;
+
+    WorkerPool* pool = aio->workers;
+    pthread_mutex_lock(&pool->lock);
+    for (unsigned i = 0; i < aio->staged_count; i++) {
+        IORequest* request = &aio->requests[aio->staged[i]];
+        request->next = NULL;
+        if (pool->work_tail) {
+            pool->work_tail->next = request;
+        } else {
+            pool->work_head = request;
+        }
+        pool->work_tail = request;
+    }
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    aio->staged_count = 0;
+    return 0;
+}
+
+static size_t threads_reap(ObeliskAsyncIO* aio, ObeliskIOCompletion* out, size_t max, bool wait) {
+    size_t count = 0;
+
+    WorkerPool* pool = aio->workers;
+    pthread_mutex_lock(&pool->lock);
+    if (wait && aio->free_count < aio->depth) {
+        while (aio->done_count == 0) {
+            pthread_cond_wait(&aio->work_done, &pool->lock);
+        }
+    }
+    while (aio->done_count > 0 && count < max) {
+        uint32_t slot = aio->done[aio->done_head];
+        aio->done_head = (aio->done_head + 1) % aio->depth;
+        aio->done_count--;
+
+        out[count].tag = aio->requests[slot].tag;
+        out[count].result = aio->requests[slot].result;
+        aio->free_slots[aio->free_count++] = slot;
+        count++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return count;
+}
+
+// Public interface
+
+static void free_aio(ObeliskAsyncIO* aio) {
+    if (aio->kind == BACKEND_THREADS) {
+        threads_release(aio);
+        pthread_cond_destroy(&aio->work_done);
+    }
+    uring_unmap(aio);
+    free(aio->done);
+    free(aio->staged);
+    free(aio->free_slots);
+    free(aio->requests);
+    free(aio);
+}
+
+ObeliskAsyncIO* async_io_create(int fd, unsigned depth, ObeliskAsyncIOBackend backend) {
+    return async_io_create_shared(fd, depth, backend, NULL);
+}
+
+ObeliskAsyncIO* async_io_create_shared(int fd, unsigned depth, ObeliskAsyncIOBackend backend,
+                                       ObeliskAsyncIO* share) {
+    if (fd < 0 || depth == 0) return NULL;
+
+    ObeliskAsyncIO* aio = calloc(1, sizeof(ObeliskAsyncIO));
+    if (!aio) return NULL;
+    aio->fd = fd;
+    aio->depth = depth;
+    aio->ring_fd = -1;
+    aio->kind = BACKEND_URING;
+
+    // A shared instance keeps to the backend of the one it shares with
+    if (share && share->kind == BACKEND_THREADS) backend = OBELISK_ASYNC_IO_THREADS;
+    int share_fd = share && share->kind == BACKEND_URING ? share->ring_fd : -1;
+    if (backend == OBELISK_ASYNC_IO_THREADS || uring_init(aio, share_fd) != 0) {
+        aio->kind = BACKEND_THREADS;
+        pthread_cond_init(&aio->work_done, NULL);
+        if (threads_init(aio, share && share->kind == BACKEND_THREADS ? share : NULL) != 0) {
+            free_aio(aio);
+            return NULL;
+        }
+    }
+
+    aio->requests = calloc(aio->depth, sizeof(IORequest));
+    aio->free_slots = malloc(aio->depth * sizeof(uint32_t));
+    aio->staged = malloc(aio->depth * sizeof(uint32_t));
+    if (!aio->requests || !aio->free_slots || !aio->staged) {
+        free_aio(aio);
+        return NULL;
+    }
+    for (unsigned i = 0; i < aio->depth; i++) {
+        aio->free_slots[i] = aio->depth - 1 - i;
+        aio->requests[i].owner = aio;
+        aio->requests[i].slot = i;
+    }
+    aio->free_count = aio->depth;
+
+    return aio;
+}
+
+void async_io_destroy(ObeliskAsyncIO* aio) {
+    if (!aio) return;
+
+    // Buffers may still be written by requests in flight
+    ObeliskIOCompletion completions[16];
+    async_io_submit(aio);
+    while (async_io_pending(aio) > 0) {
+        async_io_reap(aio, completions, 16, true);
+    }
+    free_aio(aio);
+}
+
+const char* async_io_backend_name(const ObeliskAsyncIO* aio) {
+    if (!aio) return "none";
+    return aio->kind == BACKEND_URING ? "io_uring" : "threads";
+}
+
+static int queue_request(ObeliskAsyncIO* aio, void* buf, size_t len, off_t offset,
+                         uint64_t tag, bool write) {
+    if (!aio || aio->free_count == 0) return -1;
+
+    uint32_t slot = aio->free_slots[--aio->free_count];
+    IORequest* request = &aio->requests[slot];
+    request->iov.iov_base = buf;
+    request->iov.iov_len = len;
+    request->offset = offset;
+    request->tag = tag;
+    request->result = 0;
+    request->write = write;
+    request->next = NULL;
+
+    aio->staged[aio->staged_count++] = slot;
+    return 0;
+}
+
+int async_io_queue_read(ObeliskAsyncIO* aio, void* buf, size_t len, off_t offset, uint64_t tag) {
+    return queue_request(aio, buf, len, offset, tag, false);
+}
+
+int async_io_queue_write(ObeliskAsyncIO* aio, const void* buf, size_t len, off_t offset, uint64_t tag) {
+    return queue_request(aio, (void*)buf, len, offset, tag, true);
+}
+
+int async_io_submit(ObeliskAsyncIO* aio) {
+    if (!aio) return -1;
+    return aio->kind == BACKEND_URING ? uring_submit(aio) : threads_submit(aio);
+}
+
+size_t async_io_reap(ObeliskAsyncIO* aio, ObeliskIOCompletion* out, size_t max, bool wait) {
+    if (!aio || !out || max == 0) return 0;
+
+    // Anything still staged would never complete
+    if (wait && async_io_submit(aio) != 0) return 0;
+    return aio->kind == BACKEND_URING ? uring_reap(aio, out, max, wait)
+                                      : threads_reap(aio, out, max, wait);
+}
+
+size_t async_io_pending(const ObeliskAsyncIO* aio) {
+    return aio ? aio->depth - aio->free_count : 0;
+}
@@ -0,0 +1,58 @@
+#ifndef OBELISK_ASYNC_IO_H
+#define OBELISK_ASYNC_IO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// Asynchronous positional I/O against one file descriptor. Requests are
+// queued with async_io_queue_*, handed to the kernel together by
+// async_io_submit, and their completions collected with async_io_reap.
+// io_uring is used where the kernel allows it; otherwise a small pool of
+// threads issues plain pread/pwrite calls. All calls on one instance must
+// come from one thread (or be serialized by the caller).
+
+typedef struct ObeliskAsyncIO ObeliskAsyncIO;
+
+typedef enum {
+    OBELISK_ASYNC_IO_AUTO,     // io_uring, falling back to threads
+    OBELISK_ASYNC_IO_THREADS   // Always use the thread pool
+} ObeliskAsyncIOBackend;
+
+typedef struct {
+    uint64_t tag;     // Caller's tag from the request
+    ssize_t result;   // Bytes transferred, or -errno
+} ObeliskIOCompletion;
+
+// depth bounds the number of requests in flight at once
+ObeliskAsyncIO* async_io_create(int fd, unsigned depth, ObeliskAsyncIOBackend backend);
+
+// Like async_io_create, but doing the blocking work on share's threads: its
+// thread pool, or with io_uring the kernel's workers behind its ring. Any
+// number of instances then cost the threads of one. share may be NULL, and
+// instances sharing threads may be destroyed in any order.
+ObeliskAsyncIO* async_io_create_shared(int fd, unsigned depth, ObeliskAsyncIOBackend backend,
+                                       ObeliskAsyncIO* share);
+
+// Waits for every request in flight; their completions are discarded
+void async_io_destroy(ObeliskAsyncIO* aio);
+
+const char* async_io_backend_name(const ObeliskAsyncIO* aio);
+
+// Queue a request. Returns -1 if depth requests are already in flight; reap
+// some completions and try again.
+int async_io_queue_read(ObeliskAsyncIO* aio, void* buf, size_t len, off_t offset, uint64_t tag);
+int async_io_queue_write(ObeliskAsyncIO* aio, const void* buf, size_t len, off_t offset, uint64_t tag);
+
+// Start every queued request
+int async_io_submit(ObeliskAsyncIO* aio);
+
+// Collect up to max completions. With wait set, blocks until at least one
+// is available unless nothing is in flight. Returns the number collected.
+size_t async_io_reap(ObeliskAsyncIO* aio, ObeliskIOCompletion* out, size_t max, bool wait);
+
+// Requests queued or in flight
+size_t async_io_pending(const ObeliskAsyncIO* aio);
+
+#endif // OBELISK_ASYNC_IO_H
@@ -1,245 +1,1870 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  // O_DIRECT
+#endif
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <obelisk/buffer_pool.h>
+#include "page_table.h"
+#include "async_io.h"
+#include "replacer.h"
+#include "frame_memory.h"
+#include "warm_manifest.h"
+
+// Direct I/O needs buffers, offsets and lengths aligned to the device's
+// logical block size; a 4 KiB boundary covers every common device
+#define FRAME_ALIGNMENT 4096
+
+// Most reads and writes kept in flight at once by each shard
+#define ASYNC_IO_DEPTH 128
+
+// Completions collected per reap
+#define REAP_BATCH 32
+
+// Default sharding: one shard per CPU, each with at least this many frames
+#define MAX_SHARDS 64
+#define MIN_SHARD_FRAMES 64
+
+#define CACHE_LINE_SIZE 64
+
+// Background cleaner: pages written per round, pages per vectored write,
+// and how long it sleeps when there is little or some work
+#define CLEANER_BATCH 256
+#define CLEANER_MAX_RUN 64
+
+// The cleaner holds at most this fraction (1/n) of a shard's frames at once,
+// so misses in the shard still find victims while it writes
+#define CLEANER_SHARD_DIVISOR 4
+#define CLEANER_IDLE_MS 100
+#define CLEANER_TRICKLE_MS 10
+
+// How long a shrink waits for pages above the new size to be unpinned (or
+// released by their owner) before it gives up
+#define RESIZE_PIN_WAIT_MS 1000
+
+// Frame states seen by the cleaner
+enum {
+    CLEANING_NONE = 0,
+    CLEANING_ACTIVE,    // Being written by the cleaner
+    CLEANING_DROPPED    // Deleted meanwhile; freed once the write is done
+};
+
+// Asynchronous I/O in flight on a frame
+enum {
+    FRAME_IO_NONE = 0,
+    FRAME_IO_READ,
+    FRAME_IO_WRITE
+};
+
+// Per-shard counters. Only the latch holder writes them, with relaxed atomic
+// stores, so a snapshot can read them without the latch.
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t flushes;
+    uint64_t foreground_writebacks;
+    uint64_t victim_stalls;
+    uint64_t class_hits[OBELISK_PAGE_CLASS_COUNT];
+    uint64_t class_misses[OBELISK_PAGE_CLASS_COUNT];
+    uint64_t evictions[OBELISK_EVICT_REASON_COUNT];
+    ObeliskLatencyHistogram miss_latency;
+    ObeliskLatencyHistogram flush_latency;
+} ShardStats;
+
+// Frames come in chunks, one per shard each time the pool grows, so a
+// page's descriptor and data never move once handed out. A shard's newest
+// chunk may be only partly in use after a shrink.
+typedef struct FrameChunk {
+    struct FrameChunk* next;      // Older chunk of the same shard
+    ObeliskPage* pages;
+    ObeliskFrameMemory memory;    // Frame data
+    size_t first;                 // Shard frame index of pages[0]
+    size_t count;
+} FrameChunk;
+
+// The pool is split into shards by page id hash. Each shard owns a slice of
+// the frames with its own page table, replacement state, I/O queue and
+// counters, all guarded by its latch, so threads working on different pages
+// rarely meet. Frame indexes below are relative to the shard.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) pthread_mutex_t latch;
+    ObeliskBufferPool* pool;
+    ObeliskPage** frames;         // Frame index -> descriptor
+    size_t num_frames;
+    size_t capacity;              // Entries allocated in the per-frame arrays
+    size_t frame_limit;           // Frames from here on are being given up
+    FrameChunk* chunks;           // Newest first
+    int node;                     // NUMA node for frame memory, or FRAME_MEMORY_NO_NODE
+    ObeliskPageTable page_table;  // page_id -> frame
+
+    // Frames holding no page are handed out first; after that the
+    // replacer picks which page to give up
+    ObeliskReplacer* replacer;
+    uint32_t* free_frames;
+    size_t free_count;
+
+    // Prefetch and write-back run asynchronously when there is a data file.
+    // A frame with I/O in flight stays out of reach until it completes.
+    ObeliskAsyncIO* aio;
+    uint8_t* frame_io;            // FRAME_IO_* per frame
+
+    // Dirty frames in no particular order, for the cleaner to pick from.
+    // dirty_gen changes whenever a frame is dirtied, so the cleaner can
+    // tell whether a page it wrote was modified while the write ran.
+    uint32_t* dirty_list;
+    uint32_t* dirty_pos;          // Index into dirty_list per frame
+    size_t dirty_count;           // Atomic; read by the cleaner unlatched
+    size_t dirty_limit;           // Dirty frames that wake the cleaner
+    uint32_t* dirty_gen;
+    uint8_t* cleaning;            // CLEANING_* per frame
+    size_t cleaning_count;        // Frames the cleaner has in hand
+    pthread_cond_t cleaned;       // Signalled as the cleaner hands frames back
+
+    ShardStats stats;
+} PoolShard;
+
+typedef struct {
+    uint64_t page_id;
+    uint32_t shard;
+    uint32_t frame;
+    uint32_t gen;
+    bool written;
+} CleanerCandidate;
 
 // Internal buffer pool structure
 struct ObeliskBufferPool {
-    ObeliskPage* pages;
-    size_t pool_size;
+    size_t pool_size;             // Atomic; changes on resize
     size_t page_size;
     const char* data_file;
-    bool use_direct_io;
+    int fd;                       // -1 when the pool is memory-only
+    bool use_direct_io;           // O_DIRECT is actually in effect
+    bool use_huge_pages;
     size_t prefetch_size;
     ObeliskReplacementPolicy policy;
-    
-    // Statistics
-    uint64_t hits;
-    uint64_t misses;
-    uint64_t evictions;
-    uint64_t flushes;
+    uint64_t next_page_id;        // Atomic
+
+    // Owner of the swizzled pages, asked before one is evicted. Changed
+    // only with every shard latched.
+    ObeliskEvictionFn evict_fn;
+    void* evict_ctx;
+
+    PoolShard* shards;
+    size_t num_shards;
+
+    // Sequential read-ahead: the page a sequential scan touches next, and
+    // the first page not yet requested ahead of it
+    pthread_mutex_t readahead_lock;
+    uint64_t seq_next;
+    uint64_t readahead_end;
+
+    // Background cleaner. flush_lock admits one writer of dirty pages at a
+    // time, a cleaner round or flush_all, so a flush never misses a page
+    // the cleaner has in hand.
+    pthread_t cleaner;
+    bool cleaner_running;
+    bool cleaner_stop;
+    pthread_mutex_t cleaner_lock;
+    pthread_cond_t cleaner_wake;
+    pthread_mutex_t flush_lock;
+    double clean_target;
+    size_t dirty_limit;           // Atomic; above this the cleaner writes without pause
+    size_t next_shard;            // Where the next round starts collecting
+    CleanerCandidate* candidates;
+    struct iovec* iov;
+    uint64_t cleaner_pages;       // Atomic
+    uint64_t cleaner_writes;      // Atomic
+    ObeliskLatencyHistogram cleaner_latency;  // Written under flush_lock, read like ShardStats
+
+    // Warm restart. The cleaner thread first reads back the pages listed
+    // in the manifest, then saves the list every manifest_interval_ns.
+    char* manifest_file;
+    pthread_mutex_t manifest_lock;  // One save at a time
+    uint64_t manifest_interval_ns;
+    uint64_t next_manifest_ns;
+    uint64_t* warm_pages;         // Left to read back, owned by the cleaner
+    size_t warm_count;
+    uint64_t warmed_pages;        // Atomic
 };
 
-ObeliskBufferPool* buffer_pool_create(const ObeliskBufferPoolConfig* config) {
-    if (!config) return NULL;
+// Multiply-shift range reduction of a Fibonacci hash. Shard tables index by
+// the low bits of the same 32-bit hash, which this leaves evenly spread.
+static inline PoolShard* shard_of(ObeliskBufferPool* pool, uint64_t page_id) {
+    uint64_t hash = (page_id * 0x9E3779B97F4A7C15ull) >> 32;
+    return &pool->shards[(hash * pool->num_shards) >> 32];
+}
 
-    ObeliskBufferPool* pool = malloc(sizeof(ObeliskBufferPool));
-    if (!pool) return NULL;
+static uint32_t pin_count(const ObeliskPage* page) {
+    return __atomic_load_n(&page->pin_count, __ATOMIC_ACQUIRE);
+}
 
-    pool->pages = calloc(config->pool_size, sizeof(ObeliskPage));
-    if (!pool->pages) {
-        free(pool);
-        return NULL;
+static inline void stat_add(uint64_t* counter, uint64_t n) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t stat_read(const uint64_t* counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void record_latency(ObeliskLatencyHistogram* histogram, uint64_t start) {
+    uint64_t ns = now_ns() - start;
+    unsigned bucket = ns > 0 ? 63 - (unsigned)__builtin_clzll(ns) : 0;
+    if (bucket >= OBELISK_LATENCY_BUCKETS) bucket = OBELISK_LATENCY_BUCKETS - 1;
+    stat_add(&histogram->buckets[bucket], 1);
+    stat_add(&histogram->count, 1);
+    stat_add(&histogram->total_ns, ns);
+    if (ns > histogram->max_ns) __atomic_store_n(&histogram->max_ns, ns, __ATOMIC_RELAXED);
+}
+
+// The access clock pages are stamped with
+static inline uint64_t access_clock(const PoolShard* shard) {
+    return shard->stats.hits + shard->stats.misses;
+}
+
+static void free_chunk(FrameChunk* chunk) {
+    frame_memory_unmap(&chunk->memory);
+    free(chunk->pages);
+    free(chunk);
+}
+
+static void free_shard(PoolShard* shard) {
+    async_io_destroy(shard->aio);
+    replacer_destroy(shard->replacer);
+    page_table_destroy(&shard->page_table);
+    while (shard->chunks) {
+        FrameChunk* chunk = shard->chunks;
+        shard->chunks = chunk->next;
+        free_chunk(chunk);
+    }
+    free(shard->frames);
+    free(shard->dirty_list);
+    free(shard->dirty_pos);
+    free(shard->dirty_gen);
+    free(shard->cleaning);
+    free(shard->frame_io);
+    free(shard->free_frames);
+    pthread_cond_destroy(&shard->cleaned);
+    pthread_mutex_destroy(&shard->latch);
+}
+
+static void free_pool(ObeliskBufferPool* pool) {
+    for (size_t i = 0; pool->shards && i < pool->num_shards; i++) {
+        free_shard(&pool->shards[i]);
+    }
+    free(pool->shards);
+    free(pool->candidates);
+    free(pool->iov);
+    pthread_mutex_destroy(&pool->readahead_lock);
+    pthread_mutex_destroy(&pool->cleaner_lock);
+    pthread_cond_destroy(&pool->cleaner_wake);
+    pthread_mutex_destroy(&pool->flush_lock);
+    pthread_mutex_destroy(&pool->manifest_lock);
+    if (pool->fd >= 0) close(pool->fd);
+    free((void*)pool->data_file);
+    free(pool->manifest_file);
+    free(pool->warm_pages);
+    free(pool);
+}
+
+// Open the data file, falling back to buffered I/O where O_DIRECT is refused
+// (tmpfs, some network filesystems) or the page size cannot satisfy it
+static int open_data_file(ObeliskBufferPool* pool, bool direct) {
+    int flags = O_RDWR | O_CREAT;
+    if (direct && pool->page_size % FRAME_ALIGNMENT == 0) {
+        pool->fd = open(pool->data_file, flags | O_DIRECT, 0644);
+        if (pool->fd >= 0) {
+            pool->use_direct_io = true;
+            return 0;
+        }
+        if (errno != EINVAL) return -1;
+    }
+
+    pool->fd = open(pool->data_file, flags, 0644);
+    return pool->fd >= 0 ? 0 : -1;
+}
+
+static size_t choose_num_shards(const ObeliskBufferPoolConfig* config) {
+    size_t shards = config->num_shards;
+    if (shards == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        shards = cpus > 0 ? (size_t)cpus : 1;
+        if (shards > MAX_SHARDS) shards = MAX_SHARDS;
+        if (shards > config->pool_size / MIN_SHARD_FRAMES) shards = config->pool_size / MIN_SHARD_FRAMES;
     }
+    if (shards > config->pool_size) shards = config->pool_size;
+    return shards > 0 ? shards : 1;
+}
+
+static int grow_shard(PoolShard* shard, size_t target);
+
+static int init_shard(ObeliskBufferPool* pool, PoolShard* shard, size_t num_frames, int node) {
+    shard->pool = pool;
+    shard->node = node;
+    if (page_table_init(&shard->page_table, num_frames) != 0) return -1;
+    if (grow_shard(shard, num_frames) != 0) return -1;
 
+    // Every shard queues its own requests, but they all share the first
+    // shard's I/O threads, so the thread count does not grow with shards
+    if (pool->fd >= 0) {
+        unsigned depth = num_frames < ASYNC_IO_DEPTH ? (unsigned)num_frames : ASYNC_IO_DEPTH;
+        ObeliskAsyncIO* share = shard == &pool->shards[0] ? NULL : pool->shards[0].aio;
+        shard->aio = async_io_create_shared(pool->fd, depth, OBELISK_ASYNC_IO_AUTO, share);
+        if (!shard->aio) return -1;
+    }
+    return 0;
+}
+
+static void* cleaner_main(void* arg);
+
+// Pick up the page list a previous pool saved, keeping no more pages than
+// fit and none past the end of the data file. A missing or unusable list
+// just means a cold start.
+static int load_manifest(ObeliskBufferPool* pool, const ObeliskBufferPoolConfig* config) {
+    pool->manifest_file = strdup(config->manifest_file);
+    if (!pool->manifest_file) return -1;
+    pool->manifest_interval_ns = (uint64_t)config->manifest_interval_ms * 1000000;
+    pool->next_manifest_ns = now_ns() + pool->manifest_interval_ns;
+
+    size_t count;
+    uint64_t* page_ids = warm_manifest_load(pool->manifest_file, pool->page_size, pool->pool_size, &count);
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (page_ids[i] > 0 && page_ids[i] < pool->next_page_id) page_ids[kept++] = page_ids[i];
+    }
+    pool->warm_pages = page_ids;
+    pool->warm_count = kept;
+    return 0;
+}
+
+ObeliskBufferPool* buffer_pool_create(const ObeliskBufferPoolConfig* config) {
+    if (!config || config->page_size == 0) return NULL;
+    if (config->pool_size == 0 || config->pool_size >= PAGE_TABLE_NOT_FOUND) return NULL;
+    if (config->clean_target < 0.0 || config->clean_target >= 1.0) return NULL;
+
+    double clean_target = config->clean_target > 0.0 ? config->clean_target
+                                                     : OBELISK_BUFFER_POOL_DEFAULT_CLEAN_TARGET;
+
+    ObeliskBufferPool* pool = calloc(1, sizeof(ObeliskBufferPool));
+    if (!pool) return NULL;
+
+    pool->fd = -1;
     pool->pool_size = config->pool_size;
+    pool->clean_target = clean_target;
     pool->page_size = config->page_size;
-    pool->data_file = strdup(config->data_file);
-    pool->use_direct_io = config->use_direct_io;
+    pool->use_huge_pages = config->use_huge_pages;
     pool->prefetch_size = config->prefetch_size;
     pool->policy = OBELISK_POLICY_LRU;
+    pool->next_page_id = 1;  // Leave 0 free for callers to use as a null page id
+    pthread_mutex_init(&pool->readahead_lock, NULL);
+    pthread_mutex_init(&pool->cleaner_lock, NULL);
+    pthread_cond_init(&pool->cleaner_wake, NULL);
+    pthread_mutex_init(&pool->flush_lock, NULL);
+    pthread_mutex_init(&pool->manifest_lock, NULL);
+    pool->dirty_limit = (size_t)((1.0 - clean_target) * (double)pool->pool_size);
 
-    // Initialize statistics
-    pool->hits = 0;
-    pool->misses = 0;
-    pool->evictions = 0;
-    pool->flushes = 0;
-
-    // Initialize pages
-    for (size_t i = 0; i < pool->pool_size; i++) {
-        pool->pages[i].data = malloc(pool->page_size);
-        if (!pool->pages[i].data) {
-            // Cleanup on failure
-            for (size_t j = 0; j < i; j++) {
-                free(pool->pages[j].data);
-            }
-            free(pool->pages);
-            free((void*)pool->data_file);
-            free(pool);
+    // Without a data file the pool is memory-only and never evicts dirty pages
+    if (config->data_file) {
+        pool->data_file = strdup(config->data_file);
+        if (!pool->data_file || open_data_file(pool, config->use_direct_io) != 0) {
+            free_pool(pool);
+            return NULL;
+        }
+
+        // Existing pages keep their ids; new ones are appended after them
+        struct stat st;
+        if (fstat(pool->fd, &st) != 0) {
+            free_pool(pool);
+            return NULL;
+        }
+        uint64_t file_pages = ((uint64_t)st.st_size + pool->page_size - 1) / pool->page_size;
+        if (file_pages > pool->next_page_id) pool->next_page_id = file_pages;
+    }
+
+    // Frames are dealt out to the shards as evenly as they divide
+    size_t num_shards = choose_num_shards(config);
+    pool->shards = aligned_alloc(CACHE_LINE_SIZE, num_shards * sizeof(PoolShard));
+    if (!pool->shards) {
+        free_pool(pool);
+        return NULL;
+    }
+    memset(pool->shards, 0, num_shards * sizeof(PoolShard));
+
+    // Shards take turns across the NUMA nodes, each keeping its frames on one
+    int nodes[FRAME_MEMORY_MAX_NODES];
+    int num_nodes = config->numa_aware ? frame_memory_numa_nodes(nodes, FRAME_MEMORY_MAX_NODES) : 0;
+
+    for (size_t i = 0; i < num_shards; i++) {
+        size_t frames = pool->pool_size / num_shards + (i < pool->pool_size % num_shards);
+        int node = num_nodes > 1 ? nodes[i % (size_t)num_nodes] : FRAME_MEMORY_NO_NODE;
+        pthread_mutex_init(&pool->shards[i].latch, NULL);
+        pthread_cond_init(&pool->shards[i].cleaned, NULL);
+        pool->num_shards++;
+        if (init_shard(pool, &pool->shards[i], frames, node) != 0) {
+            free_pool(pool);
             return NULL;
         }
-        pool->pages[i].page_id = 0;
-        pool->pages[i].state = OBELISK_PAGE_CLEAN;
-        pool->pages[i].pin_count = 0;
-        pool->pages[i].last_accessed = 0;
+    }
+
+    // Only a pool with a data file has pages worth keeping warm
+    if (config->manifest_file && pool->fd >= 0 && load_manifest(pool, config) != 0) {
+        free_pool(pool);
+        return NULL;
+    }
+
+    // Only a pool with a data file has anywhere to clean pages to
+    if (pool->fd >= 0) {
+        pool->candidates = malloc(CLEANER_BATCH * sizeof(CleanerCandidate));
+        pool->iov = malloc(CLEANER_MAX_RUN * sizeof(struct iovec));
+        if (!pool->candidates || !pool->iov ||
+            pthread_create(&pool->cleaner, NULL, cleaner_main, pool) != 0) {
+            free_pool(pool);
+            return NULL;
+        }
+        pool->cleaner_running = true;
     }
 
     return pool;
 }
 
-void buffer_pool_destroy(ObeliskBufferPool* pool) {
-    if (!pool) return;
+static off_t frame_offset(const ObeliskBufferPool* pool, const ObeliskPage* page) {
+    return (off_t)(page->page_id * pool->page_size);
+}
+
+static int read_frame(ObeliskBufferPool* pool, ObeliskPage* page) {
+    if (pool->fd < 0) {
+        memset(page->data, 0, pool->page_size);
+        return 0;
+    }
 
-    if (pool->pages) {
-        for (size_t i = 0; i < pool->pool_size; i++) {
-            free(pool->pages[i].data);
+    char* data = page->data;
+    off_t offset = frame_offset(pool, page);
+    size_t done = 0;
+    while (done < pool->page_size) {
+        ssize_t n = pread(pool->fd, data + done, pool->page_size - done, offset + (off_t)done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
         }
-        free(pool->pages);
+        if (n == 0) break;  // Past the end of the file: never written
+        done += (size_t)n;
     }
 
-    free((void*)pool->data_file);
-    free(pool);
+    memset(data + done, 0, pool->page_size - done);
+    return 0;
 }
 
-static ObeliskPage* find_page(ObeliskBufferPool* pool, uint64_t page_id) {
-    for (size_t i = 0; i < pool->pool_size; i++) {
-        if (pool->pages[i].page_id == page_id) {
-            return &pool->pages[i];
+static void wake_cleaner(ObeliskBufferPool* pool) {
+    if (!pool->cleaner_running) return;
+    pthread_mutex_lock(&pool->cleaner_lock);
+    pthread_cond_signal(&pool->cleaner_wake);
+    pthread_mutex_unlock(&pool->cleaner_lock);
+}
+
+static void mark_dirty(PoolShard* shard, ObeliskPage* page) {
+    uint32_t frame = page->frame;
+    shard->dirty_gen[frame]++;
+    if (page->state == OBELISK_PAGE_DIRTY) return;
+
+    page->state = OBELISK_PAGE_DIRTY;
+    size_t count = __atomic_load_n(&shard->dirty_count, __ATOMIC_RELAXED);
+    shard->dirty_pos[frame] = (uint32_t)count;
+    shard->dirty_list[count] = frame;
+    __atomic_store_n(&shard->dirty_count, count + 1, __ATOMIC_RELAXED);
+
+    // Wake the cleaner once, as the shard crosses its limit
+    if (count + 1 == shard->dirty_limit) wake_cleaner(shard->pool);
+}
+
+static void mark_clean(PoolShard* shard, ObeliskPage* page) {
+    if (page->state != OBELISK_PAGE_DIRTY) return;
+
+    uint32_t frame = page->frame;
+    size_t count = __atomic_load_n(&shard->dirty_count, __ATOMIC_RELAXED) - 1;
+    uint32_t moved = shard->dirty_list[count];
+    shard->dirty_list[shard->dirty_pos[frame]] = moved;
+    shard->dirty_pos[moved] = shard->dirty_pos[frame];
+    __atomic_store_n(&shard->dirty_count, count, __ATOMIC_RELAXED);
+    page->state = OBELISK_PAGE_CLEAN;
+}
+
+// Write a dirty page back and mark it clean. Memory-only pools have nowhere
+// to write, so their pages stay dirty and are never chosen for eviction.
+static int write_frame(PoolShard* shard, ObeliskPage* page) {
+    ObeliskBufferPool* pool = shard->pool;
+    if (pool->fd < 0 || page->state != OBELISK_PAGE_DIRTY) return 0;
+
+    uint64_t start = now_ns();
+    const char* data = page->data;
+    off_t offset = frame_offset(pool, page);
+    size_t done = 0;
+    while (done < pool->page_size) {
+        ssize_t n = pwrite(pool->fd, data + done, pool->page_size - done, offset + (off_t)done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
         }
+        done += (size_t)n;
     }
-    return NULL;
+
+    mark_clean(shard, page);
+    stat_add(&shard->stats.flushes, 1);
+    record_latency(&shard->stats.flush_latency, start);
+    return 0;
 }
 
-static ObeliskPage* find_victim_page(ObeliskBufferPool* pool) {
-    // Simple clock algorithm
-    static size_t clock_hand = 0;
-    size_t start = clock_hand;
+// Return an empty frame to the free list, unless a shrink is giving it up
+static void release_frame(PoolShard* shard, uint32_t frame) {
+    if (frame < shard->frame_limit) shard->free_frames[shard->free_count++] = frame;
+}
 
-    do {
-        ObeliskPage* page = &pool->pages[clock_hand];
-        if (page->pin_count == 0) {
-            if (page->state == OBELISK_PAGE_CLEAN) {
-                return page;
-            }
+// Empty a frame without writing it back. A frame the cleaner is writing
+// is handed back to the free list once the write is done.
+static void drop_page(PoolShard* shard, ObeliskPage* page) {
+    uint32_t frame = page->frame;
+    page_table_remove(&shard->page_table, page->page_id);
+    replacer_remove(shard->replacer, frame);
+    mark_clean(shard, page);
+    page->is_valid = false;
+    page->swizzled = false;
+    if (shard->cleaning[frame] == CLEANING_ACTIVE) {
+        shard->cleaning[frame] = CLEANING_DROPPED;
+    } else {
+        release_frame(shard, frame);
+    }
+}
+
+// Finish a read or write the async engine reports done. Returns -1 if it
+// failed: a failed read drops the page, a failed write leaves it dirty.
+static int complete_io(PoolShard* shard, const ObeliskIOCompletion* completion) {
+    ObeliskPage* page = shard->frames[completion->tag];
+    uint8_t io = shard->frame_io[completion->tag];
+    shard->frame_io[completion->tag] = FRAME_IO_NONE;
+
+    if (io == FRAME_IO_READ) {
+        if (completion->result < 0) {
+            drop_page(shard, page);
+            return -1;
         }
-        clock_hand = (clock_hand + 1) % pool->pool_size;
-    } while (clock_hand != start);
+        // A short read ran past the end of the file
+        size_t done = (size_t)completion->result;
+        memset((char*)page->data + done, 0, shard->pool->page_size - done);
+        return 0;
+    }
 
-    return NULL;  // No victim found
+    if (completion->result != (ssize_t)shard->pool->page_size) return -1;
+    mark_clean(shard, page);
+    stat_add(&shard->stats.flushes, 1);
+    return 0;
 }
 
-ObeliskPage* buffer_pool_get_page(ObeliskBufferPool* pool, uint64_t page_id) {
-    if (!pool) return NULL;
+// Process whatever has completed; with wait set, block for at least one
+static int reap_io(PoolShard* shard, bool wait) {
+    ObeliskIOCompletion completions[REAP_BATCH];
+    size_t n = async_io_reap(shard->aio, completions, REAP_BATCH, wait);
+
+    int rc = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (complete_io(shard, &completions[i]) != 0) rc = -1;
+    }
+    return rc;
+}
+
+static void wait_frame(PoolShard* shard, ObeliskPage* page) {
+    uint32_t frame = page->frame;
+    while (shard->frame_io[frame] != FRAME_IO_NONE) {
+        reap_io(shard, true);
+    }
+}
+
+// Look a page up, waiting out any I/O in flight on its frame. Returns NULL
+// if the page is not resident, including when its prefetch failed.
+static ObeliskPage* find_page(PoolShard* shard, uint64_t page_id) {
+    uint32_t frame = page_table_find(&shard->page_table, page_id);
+    if (frame == PAGE_TABLE_NOT_FOUND) return NULL;
+
+    ObeliskPage* page = shard->frames[frame];
+    if (shard->frame_io[frame] != FRAME_IO_NONE) {
+        wait_frame(shard, page);
+        if (!page->is_valid) return NULL;
+    }
+    return page;
+}
+
+// Point a frame from take_frame at a new page of page_class, evicting the
+// page it held for reason. The new page is admitted to the replacer but not
+// yet referenced.
+static int install_page(PoolShard* shard, ObeliskPage* page, uint64_t page_id,
+                        ObeliskPageClass page_class, ObeliskEvictionReason reason) {
+    uint32_t frame = page->frame;
+    if (page->is_valid) {
+        page_table_remove(&shard->page_table, page->page_id);
+        replacer_evict(shard->replacer, frame);
+        page->is_valid = false;
+        stat_add(&shard->stats.evictions[reason], 1);
+    }
+    if (page_table_insert(&shard->page_table, page_id, frame) != 0) {
+        release_frame(shard, frame);
+        return -1;
+    }
+
+    page->page_id = page_id;
+    page->page_class = page_class;
+    page->is_valid = true;
+    replacer_admit(shard->replacer, frame, page_id);
+    return 0;
+}
+
+// A victim that is still dirty is written back before it is replaced
+static ObeliskEvictionReason victim_reason(const ObeliskPage* page) {
+    return page->state == OBELISK_PAGE_DIRTY ? OBELISK_EVICT_DIRTY : OBELISK_EVICT_CLEAN;
+}
 
-    // Check if page is in pool
-    ObeliskPage* page = find_page(pool, page_id);
+// A swizzled page may only go with its owner's consent
+static bool owner_allows_eviction(const ObeliskBufferPool* pool, ObeliskPage* page) {
+    return !page->swizzled || !pool->evict_fn || pool->evict_fn(pool->evict_ctx, page, false);
+}
+
+// Have the owner drop its pointers to a swizzled page about to be evicted.
+// Changes it only tracked itself make the page dirty.
+static void unswizzle_page(PoolShard* shard, ObeliskPage* page) {
+    ObeliskBufferPool* pool = shard->pool;
+    if (!page->swizzled) return;
+    page->swizzled = false;
+    if (pool->evict_fn && pool->evict_fn(pool->evict_ctx, page, true)) mark_dirty(shard, page);
+}
+
+typedef struct {
+    PoolShard* shard;
+    bool allow_dirty;
+} VictimFilter;
+
+static bool frame_evictable(void* ctx, uint32_t frame) {
+    const VictimFilter* filter = ctx;
+    const PoolShard* shard = filter->shard;
+    ObeliskPage* page = shard->frames[frame];
+
+    if (frame >= shard->frame_limit) return false;
+    if (pin_count(page) > 0 || shard->frame_io[frame] != FRAME_IO_NONE) return false;
+    if (shard->cleaning[frame] != CLEANING_NONE) return false;
+    if (page->state != OBELISK_PAGE_CLEAN && !(filter->allow_dirty && shard->pool->fd >= 0)) return false;
+    return owner_allows_eviction(shard->pool, page);
+}
+
+// A free frame, or the one the replacer gives up to make room for page_id.
+// A swizzled victim is unswizzled, so it may come back dirty; memory-only
+// pools never pick one, since their pages never come clean.
+static ObeliskPage* take_frame(PoolShard* shard, uint64_t page_id, bool allow_dirty) {
+    if (shard->free_count > 0) return shard->frames[shard->free_frames[--shard->free_count]];
+
+    VictimFilter filter = {shard, allow_dirty};
+    uint32_t frame = replacer_victim(shard->replacer, page_id, frame_evictable, &filter);
+    if (frame == REPLACER_NONE) return NULL;
+
+    ObeliskPage* page = shard->frames[frame];
+    unswizzle_page(shard, page);
+    return page;
+}
+
+// Prefer a clean frame, so the caller need not wait on a write. Writing a
+// dirty victim in the foreground is the last resort, when the cleaner has
+// fallen behind.
+static ObeliskPage* find_victim_page(PoolShard* shard, uint64_t page_id) {
+    // Frames held by finished reads free up once their completions are seen
+    for (;;) {
+        ObeliskPage* page = take_frame(shard, page_id, false);
+        if (page) return page;
+        if (async_io_pending(shard->aio) == 0) break;
+        reap_io(shard, true);
+    }
+
+    wake_cleaner(shard->pool);
+    ObeliskPage* page = take_frame(shard, page_id, true);
+
+    // Frames the cleaner is writing come back when its round ends, and the
+    // round needs nothing this thread holds besides the latch
+    while (!page && shard->cleaning_count > 0) {
+        pthread_cond_wait(&shard->cleaned, &shard->latch);
+        page = take_frame(shard, page_id, true);
+    }
+    if (!page) {
+        stat_add(&shard->stats.victim_stalls, 1);
+    } else if (page->state == OBELISK_PAGE_DIRTY) {
+        stat_add(&shard->stats.foreground_writebacks, 1);
+    }
+    return page;
+}
+
+// Queue reads for the pages not yet resident, using only clean frames so
+// nothing is written on the way. Prefetch is a hint: it stops quietly when
+// frames or queue slots run out. Returns how many of page_ids it got to.
+static size_t queue_prefetch(PoolShard* shard, const uint64_t* page_ids, size_t count) {
+    ObeliskBufferPool* pool = shard->pool;
+
+    // Whatever has completed is collected first so its frames can be reused
+    reap_io(shard, false);
+
+    size_t queued = 0;
+    size_t i;
+    for (i = 0; i < count; i++) {
+        if (page_table_find(&shard->page_table, page_ids[i]) != PAGE_TABLE_NOT_FOUND) continue;
+
+        ObeliskPage* page = take_frame(shard, page_ids[i], false);
+        if (!page || write_frame(shard, page) != 0) break;
+        if (install_page(shard, page, page_ids[i], OBELISK_PAGE_CLASS_OTHER, OBELISK_EVICT_PREFETCH) != 0) break;
+        page->state = OBELISK_PAGE_CLEAN;
+        page->last_accessed = access_clock(shard);
+
+        uint32_t frame = page->frame;
+        if (async_io_queue_read(shard->aio, page->data, pool->page_size,
+                                frame_offset(pool, page), frame) != 0) {
+            drop_page(shard, page);
+            break;
+        }
+        shard->frame_io[frame] = FRAME_IO_READ;
+        queued++;
+    }
+
+    if (queued > 0) async_io_submit(shard->aio);
+    return i;
+}
+
+// Hand each shard its share of page_ids under one latch acquisition
+static void prefetch_sharded(ObeliskBufferPool* pool, const uint64_t* page_ids, size_t count) {
+    if (pool->num_shards == 1) {
+        PoolShard* shard = &pool->shards[0];
+        pthread_mutex_lock(&shard->latch);
+        queue_prefetch(shard, page_ids, count);
+        pthread_mutex_unlock(&shard->latch);
+        return;
+    }
+
+    uint64_t* batch = malloc(count * sizeof(uint64_t));
+    if (!batch) return;
+
+    for (size_t s = 0; s < pool->num_shards; s++) {
+        PoolShard* shard = &pool->shards[s];
+        size_t n = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (shard_of(pool, page_ids[i]) == shard) batch[n++] = page_ids[i];
+        }
+        if (n == 0) continue;
+
+        pthread_mutex_lock(&shard->latch);
+        queue_prefetch(shard, batch, n);
+        pthread_mutex_unlock(&shard->latch);
+    }
+    free(batch);
+}
+
+// Keep up to prefetch_size pages requested ahead of a sequential scan,
+// topping the window up once half of it has been consumed. Read-ahead is a
+// hint, so a thread that finds another already at it just moves on.
+static void read_ahead(ObeliskBufferPool* pool, uint64_t page_id) {
+    if (pool->fd < 0 || pool->prefetch_size == 0) return;
+    if (pthread_mutex_trylock(&pool->readahead_lock) != 0) return;
+
+    if (page_id != pool->seq_next) {
+        pool->seq_next = page_id + 1;
+        pool->readahead_end = page_id + 1;
+        pthread_mutex_unlock(&pool->readahead_lock);
+        return;
+    }
+    pool->seq_next = page_id + 1;
+    if (pool->readahead_end <= page_id) pool->readahead_end = page_id + 1;
+
+    // A window larger than half the pool would evict what it just read
+    size_t window = pool->prefetch_size;
+    size_t pool_size = __atomic_load_n(&pool->pool_size, __ATOMIC_RELAXED);
+    if (window > pool_size / 2) window = pool_size / 2;
+    if (window > ASYNC_IO_DEPTH) window = ASYNC_IO_DEPTH;
+    if (pool->readahead_end - page_id <= window / 2) {
+        uint64_t end = page_id + 1 + window;
+        uint64_t limit = __atomic_load_n(&pool->next_page_id, __ATOMIC_RELAXED);
+        if (end > limit) end = limit;
+
+        uint64_t page_ids[ASYNC_IO_DEPTH];
+        size_t count = 0;
+        for (uint64_t id = pool->readahead_end; id < end; id++) {
+            page_ids[count++] = id;
+        }
+        if (count > 0) {
+            prefetch_sharded(pool, page_ids, count);
+            pool->readahead_end = end;
+        }
+    }
+    pthread_mutex_unlock(&pool->readahead_lock);
+}
+
+// Find or load page_id with the shard latched. A page_class other than
+// OBELISK_PAGE_CLASS_OTHER retags the page.
+static ObeliskPage* get_page_locked(PoolShard* shard, uint64_t page_id, ObeliskPageClass page_class) {
+    ObeliskPage* page = find_page(shard, page_id);
     if (page) {
-        pool->hits++;
-        page->last_accessed = pool->hits + pool->misses;
+        if (page_class != OBELISK_PAGE_CLASS_OTHER) page->page_class = page_class;
+        stat_add(&shard->stats.hits, 1);
+        stat_add(&shard->stats.class_hits[page->page_class], 1);
+        page->last_accessed = access_clock(shard);
+        replacer_touch(shard->replacer, page->frame);
         return page;
     }
 
-    pool->misses++;
+    stat_add(&shard->stats.misses, 1);
+    stat_add(&shard->stats.class_misses[page_class], 1);
+    uint64_t start = now_ns();
 
     // Find a victim page
-    page = find_victim_page(pool);
+    page = find_victim_page(shard, page_id);
     if (!page) {
         return NULL;  // No available pages
     }
 
     // If victim is dirty, write it back
-    if (page->state == OBELISK_PAGE_DIRTY) {
-        // TODO: Write page to disk
-        pool->flushes++;
-    }
+    ObeliskEvictionReason reason = victim_reason(page);
+    if (write_frame(shard, page) != 0) return NULL;
 
     // Load new page
-    page->page_id = page_id;
+    if (install_page(shard, page, page_id, page_class, reason) != 0) return NULL;
     page->state = OBELISK_PAGE_CLEAN;
-    // TODO: Read page from disk
+    if (read_frame(shard->pool, page) != 0) {
+        drop_page(shard, page);
+        return NULL;
+    }
+    page->last_accessed = access_clock(shard);
+    replacer_touch(shard->replacer, page->frame);
+    record_latency(&shard->stats.miss_latency, start);
+    return page;
+}
+
+// Load page_id and pin it. Read-ahead runs after the latch is dropped; the
+// pin keeps it from choosing the page being returned as a victim.
+static ObeliskPage* fetch_page(ObeliskBufferPool* pool, uint64_t page_id, ObeliskPageClass page_class) {
+    PoolShard* shard = shard_of(pool, page_id);
+
+    pthread_mutex_lock(&shard->latch);
+    ObeliskPage* page = get_page_locked(shard, page_id, page_class);
+    if (page) __atomic_fetch_add(&page->pin_count, 1, __ATOMIC_ACQ_REL);
+    pthread_mutex_unlock(&shard->latch);
 
+    if (page) read_ahead(pool, page_id);
     return page;
 }
 
+ObeliskPage* buffer_pool_get_page(ObeliskBufferPool* pool, uint64_t page_id) {
+    if (!pool) return NULL;
+
+    ObeliskPage* page = fetch_page(pool, page_id, OBELISK_PAGE_CLASS_OTHER);
+    if (page) __atomic_fetch_sub(&page->pin_count, 1, __ATOMIC_ACQ_REL);
+    return page;
+}
+
+ObeliskPage* buffer_pool_fetch_page(ObeliskBufferPool* pool, uint64_t page_id) {
+    if (!pool) return NULL;
+    return fetch_page(pool, page_id, OBELISK_PAGE_CLASS_OTHER);
+}
+
+ObeliskPage* buffer_pool_fetch_page_class(ObeliskBufferPool* pool, uint64_t page_id,
+                                          ObeliskPageClass page_class) {
+    if (!pool || (unsigned)page_class >= OBELISK_PAGE_CLASS_COUNT) return NULL;
+    return fetch_page(pool, page_id, page_class);
+}
+
 int buffer_pool_pin_page(ObeliskBufferPool* pool, uint64_t page_id) {
     if (!pool) return -1;
 
-    ObeliskPage* page = find_page(pool, page_id);
-    if (!page) return -1;
+    PoolShard* shard = shard_of(pool, page_id);
+    pthread_mutex_lock(&shard->latch);
+    ObeliskPage* page = find_page(shard, page_id);
+    if (page) __atomic_fetch_add(&page->pin_count, 1, __ATOMIC_ACQ_REL);
+    pthread_mutex_unlock(&shard->latch);
 
-    page->pin_count++;
-    return 0;
+    return page ? 0 : -1;
 }
 
 int buffer_pool_unpin_page(ObeliskBufferPool* pool, uint64_t page_id, bool is_dirty) {
     if (!pool) return -1;
 
-    ObeliskPage* page = find_page(pool, page_id);
-    if (!page || page->pin_count == 0) return -1;
+    PoolShard* shard = shard_of(pool, page_id);
+    pthread_mutex_lock(&shard->latch);
+    ObeliskPage* page = find_page(shard, page_id);
+    int rc = -1;
+    if (page && pin_count(page) > 0) {
+        // Dirty before the pin drops, so an evictor never sees it unpinned
+        // and clean while it still holds changes
+        if (is_dirty) {
+            mark_dirty(shard, page);
+        }
+        __atomic_fetch_sub(&page->pin_count, 1, __ATOMIC_ACQ_REL);
+        rc = 0;
+    }
+    pthread_mutex_unlock(&shard->latch);
+    return rc;
+}
+
+int buffer_pool_unpin_swizzled(ObeliskBufferPool* pool, uint64_t page_id, bool is_dirty) {
+    if (!pool) return -1;
 
-    page->pin_count--;
-    if (is_dirty) {
-        page->state = OBELISK_PAGE_DIRTY;
+    PoolShard* shard = shard_of(pool, page_id);
+    pthread_mutex_lock(&shard->latch);
+    ObeliskPage* page = find_page(shard, page_id);
+    int rc = -1;
+    if (page && pin_count(page) > 0) {
+        if (is_dirty) {
+            mark_dirty(shard, page);
+        }
+        page->swizzled = true;
+        __atomic_fetch_sub(&page->pin_count, 1, __ATOMIC_ACQ_REL);
+        rc = 0;
     }
-    return 0;
+    pthread_mutex_unlock(&shard->latch);
+    return rc;
+}
+
+int buffer_pool_set_eviction_callback(ObeliskBufferPool* pool, ObeliskEvictionFn fn, void* ctx) {
+    if (!pool) return -1;
+
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        pthread_mutex_lock(&pool->shards[i].latch);
+    }
+
+    int rc = 0;
+    if (fn && pool->evict_fn) {
+        rc = -1;  // Owned by someone else
+    } else {
+        pool->evict_fn = fn;
+        pool->evict_ctx = fn ? ctx : NULL;
+        for (size_t i = 0; i < pool->num_shards && !fn; i++) {
+            PoolShard* shard = &pool->shards[i];
+            for (size_t f = 0; f < shard->num_frames; f++) {
+                shard->frames[f]->swizzled = false;
+            }
+        }
+    }
+
+    for (size_t i = pool->num_shards; i > 0; i--) {
+        pthread_mutex_unlock(&pool->shards[i - 1].latch);
+    }
+    return rc;
 }
 
 int buffer_pool_flush_page(ObeliskBufferPool* pool, uint64_t page_id) {
     if (!pool) return -1;
 
-    ObeliskPage* page = find_page(pool, page_id);
-    if (!page) return -1;
+    PoolShard* shard = shard_of(pool, page_id);
+    pthread_mutex_lock(&shard->latch);
+    ObeliskPage* page = find_page(shard, page_id);
+    int rc = page ? write_frame(shard, page) : -1;
+    pthread_mutex_unlock(&shard->latch);
+    return rc;
+}
+
+ObeliskPage* buffer_pool_new_page(ObeliskBufferPool* pool, uint64_t* page_id) {
+    if (!pool || !page_id) return NULL;
 
-    if (page->state == OBELISK_PAGE_DIRTY) {
-        // TODO: Write page to disk
-        page->state = OBELISK_PAGE_CLEAN;
-        pool->flushes++;
+    uint64_t id = __atomic_fetch_add(&pool->next_page_id, 1, __ATOMIC_RELAXED);
+    PoolShard* shard = shard_of(pool, id);
+
+    pthread_mutex_lock(&shard->latch);
+    ObeliskPage* page = find_victim_page(shard, id);
+    ObeliskEvictionReason reason = page ? victim_reason(page) : OBELISK_EVICT_CLEAN;
+    if (!page || write_frame(shard, page) != 0 ||
+        install_page(shard, page, id, OBELISK_PAGE_CLASS_OTHER, reason) != 0) {
+        pthread_mutex_unlock(&shard->latch);
+        return NULL;
     }
 
+    // A fresh page has never been written, so it starts out dirty
+    mark_dirty(shard, page);
+    __atomic_store_n(&page->pin_count, 1, __ATOMIC_RELEASE);
+    page->last_accessed = access_clock(shard);
+    replacer_touch(shard->replacer, page->frame);
+    memset(page->data, 0, pool->page_size);
+    pthread_mutex_unlock(&shard->latch);
+
+    *page_id = id;
+    return page;
+}
+
+int buffer_pool_delete_page(ObeliskBufferPool* pool, uint64_t page_id) {
+    if (!pool) return -1;
+
+    PoolShard* shard = shard_of(pool, page_id);
+    pthread_mutex_lock(&shard->latch);
+    ObeliskPage* page = find_page(shard, page_id);
+    if (!page || pin_count(page) > 0) {
+        pthread_mutex_unlock(&shard->latch);
+        return -1;
+    }
+
+    drop_page(shard, page);
+    page->page_id = 0;
+    page->last_accessed = 0;
+    pthread_mutex_unlock(&shard->latch);
     return 0;
 }
 
+size_t buffer_pool_get_page_size(ObeliskBufferPool* pool) {
+    return pool ? pool->page_size : 0;
+}
+
+// Write every dirty page of a shard in batches of up to the queue depth,
+// then wait for the stragglers
+static int flush_shard(PoolShard* shard) {
+    ObeliskBufferPool* pool = shard->pool;
+    int rc = 0;
+
+    for (uint32_t i = 0; i < shard->num_frames; i++) {
+        ObeliskPage* page = shard->frames[i];
+        if (!page->is_valid || page->state != OBELISK_PAGE_DIRTY) continue;
+        if (shard->frame_io[i] != FRAME_IO_NONE) continue;
+
+        while (async_io_queue_write(shard->aio, page->data, pool->page_size,
+                                    frame_offset(pool, page), i) != 0) {
+            async_io_submit(shard->aio);
+            if (reap_io(shard, true) != 0) rc = -1;
+        }
+        shard->frame_io[i] = FRAME_IO_WRITE;
+    }
+
+    async_io_submit(shard->aio);
+    while (async_io_pending(shard->aio) > 0) {
+        if (reap_io(shard, true) != 0) rc = -1;
+    }
+    return rc;
+}
+
 int buffer_pool_flush_all(ObeliskBufferPool* pool) {
     if (!pool) return -1;
+    if (pool->fd < 0) return 0;  // Memory-only: nothing to write to
+
+    int rc = 0;
+    pthread_mutex_lock(&pool->flush_lock);
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        PoolShard* shard = &pool->shards[i];
+        pthread_mutex_lock(&shard->latch);
+        if (flush_shard(shard) != 0) rc = -1;
+        pthread_mutex_unlock(&shard->latch);
+    }
+    pthread_mutex_unlock(&pool->flush_lock);
+
+    // Everything becomes durable at once
+    if (fdatasync(pool->fd) != 0) rc = -1;
+    return rc;
+}
 
-    for (size_t i = 0; i < pool->pool_size; i++) {
-        if (pool->pages[i].state == OBELISK_PAGE_DIRTY) {
-            // TODO: Write page to disk
-            pool->pages[i].state = OBELISK_PAGE_CLEAN;
-            pool->flushes++;
+static size_t count_dirty(ObeliskBufferPool* pool) {
+    size_t dirty = 0;
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        dirty += __atomic_load_n(&pool->shards[i].dirty_count, __ATOMIC_RELAXED);
+    }
+    return dirty;
+}
+
+// Take up to CLEANER_BATCH dirty pages nobody holds, an even share from
+// each shard: neighbouring page ids hash to different shards, so runs only
+// form when every shard contributes. The shard that goes first rotates so
+// none is starved. Each page is flagged so it is neither evicted nor
+// reused while the cleaner writes it, so no more than a fraction of a
+// shard is taken.
+static size_t collect_dirty(ObeliskBufferPool* pool) {
+    size_t share = CLEANER_BATCH / pool->num_shards;
+    if (share == 0) share = 1;
+
+    size_t count = 0;
+    for (size_t n = 0; n < pool->num_shards && count < CLEANER_BATCH; n++) {
+        size_t s = (pool->next_shard + n) % pool->num_shards;
+        PoolShard* shard = &pool->shards[s];
+        if (__atomic_load_n(&shard->dirty_count, __ATOMIC_RELAXED) == 0) continue;
+
+        pthread_mutex_lock(&shard->latch);
+        size_t take = shard->frame_limit / CLEANER_SHARD_DIVISOR;
+        if (take > share) take = share;
+        if (take == 0) take = 1;
+        size_t limit = count + take < CLEANER_BATCH ? count + take : CLEANER_BATCH;
+        for (size_t i = 0; i < shard->dirty_count && count < limit; i++) {
+            uint32_t frame = shard->dirty_list[i];
+            ObeliskPage* page = shard->frames[frame];
+            if (pin_count(page) > 0 || shard->frame_io[frame] != FRAME_IO_NONE) continue;
+            if (shard->cleaning[frame] != CLEANING_NONE) continue;
+
+            shard->cleaning[frame] = CLEANING_ACTIVE;
+            shard->cleaning_count++;
+            pool->candidates[count++] = (CleanerCandidate){
+                .page_id = page->page_id,
+                .shard = (uint32_t)s,
+                .frame = frame,
+                .gen = shard->dirty_gen[frame],
+            };
         }
+        pthread_mutex_unlock(&shard->latch);
     }
+    pool->next_shard = (pool->next_shard + 1) % pool->num_shards;
+    return count;
+}
 
-    return 0;
+static int compare_candidates(const void* a, const void* b) {
+    uint64_t x = ((const CleanerCandidate*)a)->page_id;
+    uint64_t y = ((const CleanerCandidate*)b)->page_id;
+    return (x > y) - (x < y);
+}
+
+// Write pages with consecutive ids in one pwritev. Pages wholly written
+// are flagged; a failed or short write leaves the rest dirty. No latch is
+// held, so a page may be pinned and changed mid-write; its dirty_gen moves
+// on unpin and finish_cleaning then leaves it dirty for the next round.
+static void write_run(ObeliskBufferPool* pool, CleanerCandidate* run, size_t count) {
+    struct iovec* iov = pool->iov;
+    for (size_t i = 0; i < count; i++) {
+        iov[i].iov_base = pool->shards[run[i].shard].frames[run[i].frame]->data;
+        iov[i].iov_len = pool->page_size;
+    }
+
+    off_t offset = (off_t)(run[0].page_id * pool->page_size);
+    size_t total = count * pool->page_size;
+    size_t done = 0;
+    size_t first = 0;
+    while (done < total) {
+        uint64_t start = now_ns();
+        ssize_t n = pwritev(pool->fd, &iov[first], (int)(count - first), offset + (off_t)done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (size_t)n;
+        __atomic_fetch_add(&pool->cleaner_writes, 1, __ATOMIC_RELAXED);
+        record_latency(&pool->cleaner_latency, start);
+
+        // Resume after whatever was written, mid-page if need be
+        while ((size_t)n >= iov[first].iov_len) {
+            n -= (ssize_t)iov[first].iov_len;
+            first++;
+            if (first == count) break;
+        }
+        if (first < count) {
+            iov[first].iov_base = (char*)iov[first].iov_base + n;
+            iov[first].iov_len -= (size_t)n;
+        }
+    }
+
+    for (size_t i = 0; i < done / pool->page_size; i++) {
+        run[i].written = true;
+    }
+}
+
+// Hand written pages back to their shards. A page dirtied again while it
+// was being written stays dirty; one deleted meanwhile frees its frame.
+static size_t finish_cleaning(ObeliskBufferPool* pool, size_t count) {
+    size_t cleaned = 0;
+    for (size_t i = 0; i < count; i++) {
+        CleanerCandidate* c = &pool->candidates[i];
+        PoolShard* shard = &pool->shards[c->shard];
+        ObeliskPage* page = shard->frames[c->frame];
+
+        pthread_mutex_lock(&shard->latch);
+        if (shard->cleaning[c->frame] == CLEANING_DROPPED) {
+            release_frame(shard, c->frame);
+        } else if (c->written && shard->dirty_gen[c->frame] == c->gen) {
+            mark_clean(shard, page);
+            stat_add(&shard->stats.flushes, 1);
+            cleaned++;
+        }
+        shard->cleaning[c->frame] = CLEANING_NONE;
+        shard->cleaning_count--;
+        pthread_cond_broadcast(&shard->cleaned);
+        pthread_mutex_unlock(&shard->latch);
+    }
+    return cleaned;
+}
+
+// One round: gather dirty pages from every shard, sort them by page id and
+// write each run of adjacent pages with a single vectored write. Returns
+// how many pages came clean.
+static size_t clean_round(ObeliskBufferPool* pool) {
+    pthread_mutex_lock(&pool->flush_lock);
+    size_t count = collect_dirty(pool);
+    qsort(pool->candidates, count, sizeof(CleanerCandidate), compare_candidates);
+
+    size_t start = 0;
+    while (start < count) {
+        size_t end = start + 1;
+        while (end < count && end - start < CLEANER_MAX_RUN &&
+               pool->candidates[end].page_id == pool->candidates[end - 1].page_id + 1) {
+            end++;
+        }
+        write_run(pool, &pool->candidates[start], end - start);
+        start = end;
+    }
+
+    size_t cleaned = finish_cleaning(pool, count);
+    pthread_mutex_unlock(&pool->flush_lock);
+
+    __atomic_fetch_add(&pool->cleaner_pages, cleaned, __ATOMIC_RELAXED);
+    return cleaned;
+}
+
+static void cleaner_sleep(ObeliskBufferPool* pool, long ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(&pool->cleaner_wake, &pool->cleaner_lock, &deadline);
+}
+
+static int compare_page_ids(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Read the manifest's pages back, each shard's in page order so its reads
+// arrive at the device sorted, a queue's worth at a time. Only free frames
+// are used, so warming never pushes out a page live traffic brought in; a
+// shard is done once its list or its free frames run out.
+static void warm_up(ObeliskBufferPool* pool) {
+    size_t count = pool->warm_count;
+    uint64_t* sorted = malloc(count * sizeof(uint64_t));
+    size_t* next = calloc(pool->num_shards + 1, sizeof(size_t));
+    size_t* end = calloc(pool->num_shards, sizeof(size_t));
+    if (!sorted || !next || !end) goto done;
+
+    // Group the ids by shard, keeping page order within each group
+    qsort(pool->warm_pages, count, sizeof(uint64_t), compare_page_ids);
+    for (size_t i = 0; i < count; i++) {
+        next[shard_of(pool, pool->warm_pages[i]) - pool->shards + 1]++;
+    }
+    for (size_t s = 0; s < pool->num_shards; s++) {
+        next[s + 1] += next[s];
+        end[s] = next[s];
+    }
+    for (size_t i = 0; i < count; i++) {
+        sorted[end[shard_of(pool, pool->warm_pages[i]) - pool->shards]++] = pool->warm_pages[i];
+    }
+
+    size_t remaining = pool->num_shards;
+    while (remaining > 0 && !__atomic_load_n(&pool->cleaner_stop, __ATOMIC_RELAXED)) {
+        bool progress = false;
+        for (size_t s = 0; s < pool->num_shards; s++) {
+            if (next[s] == end[s]) continue;
+
+            PoolShard* shard = &pool->shards[s];
+            pthread_mutex_lock(&shard->latch);
+            size_t batch = end[s] - next[s];
+            if (batch > shard->free_count) batch = shard->free_count;
+            if (batch > ASYNC_IO_DEPTH) batch = ASYNC_IO_DEPTH;
+
+            size_t free_before = shard->free_count;
+            size_t done = batch > 0 ? queue_prefetch(shard, &sorted[next[s]], batch) : 0;
+            __atomic_fetch_add(&pool->warmed_pages, free_before - shard->free_count, __ATOMIC_RELAXED);
+            next[s] += done;
+
+            // A full shard, or one that stopped with its queue empty, is done
+            if (shard->free_count == 0 || (done == 0 && async_io_pending(shard->aio) == 0)) {
+                next[s] = end[s];
+            }
+            if (next[s] == end[s]) remaining--;
+            pthread_mutex_unlock(&shard->latch);
+            if (done > 0) progress = true;
+        }
+
+        // Live traffic may dirty pages meanwhile; keep up with it
+        if (count_dirty(pool) > __atomic_load_n(&pool->dirty_limit, __ATOMIC_RELAXED)) clean_round(pool);
+        if (!progress) nanosleep(&(struct timespec){.tv_nsec = 1000000}, NULL);
+    }
+
+done:
+    free(sorted);
+    free(next);
+    free(end);
+    free(pool->warm_pages);
+    pool->warm_pages = NULL;
+    pool->warm_count = 0;
+}
+
+typedef struct {
+    uint64_t page_id;
+    double heat;
+} HotPage;
+
+static int compare_heat(const void* a, const void* b) {
+    double x = ((const HotPage*)a)->heat;
+    double y = ((const HotPage*)b)->heat;
+    return (x < y) - (x > y);
+}
+
+// Resident page ids, hottest first. Each shard runs its own access clock,
+// so a page's heat is its last access relative to its shard's clock.
+static uint64_t* collect_hot_pages(ObeliskBufferPool* pool, size_t* count) {
+    size_t capacity = __atomic_load_n(&pool->pool_size, __ATOMIC_RELAXED);
+    HotPage* pages = malloc(capacity * sizeof(HotPage));
+    if (!pages) return NULL;
+
+    size_t n = 0;
+    for (size_t s = 0; s < pool->num_shards; s++) {
+        PoolShard* shard = &pool->shards[s];
+        pthread_mutex_lock(&shard->latch);
+        double clock = (double)access_clock(shard) + 1.0;
+        for (size_t f = 0; f < shard->num_frames && n < capacity; f++) {
+            ObeliskPage* page = shard->frames[f];
+            if (!page->is_valid) continue;
+            pages[n].page_id = page->page_id;
+            pages[n].heat = (double)page->last_accessed / clock;
+            n++;
+        }
+        pthread_mutex_unlock(&shard->latch);
+    }
+    qsort(pages, n, sizeof(HotPage), compare_heat);
+
+    // The ids are packed into the front of the same array
+    uint64_t* page_ids = (uint64_t*)pages;
+    for (size_t i = 0; i < n; i++) {
+        page_ids[i] = pages[i].page_id;
+    }
+    *count = n;
+    return page_ids;
+}
+
+int buffer_pool_save_manifest(ObeliskBufferPool* pool) {
+    if (!pool || !pool->manifest_file) return -1;
+
+    size_t count;
+    uint64_t* page_ids = collect_hot_pages(pool, &count);
+    if (!page_ids) return -1;
+
+    pthread_mutex_lock(&pool->manifest_lock);
+    int rc = warm_manifest_save(pool->manifest_file, pool->page_size, page_ids, count);
+    pthread_mutex_unlock(&pool->manifest_lock);
+    free(page_ids);
+    return rc;
+}
+
+// How long an idle cleaner sleeps: no later than the next manifest save
+static long idle_ms(ObeliskBufferPool* pool) {
+    if (pool->manifest_interval_ns == 0) return CLEANER_IDLE_MS;
+    uint64_t now = now_ns();
+    if (now >= pool->next_manifest_ns) return 1;
+    uint64_t ms = (pool->next_manifest_ns - now + 999999) / 1000000;
+    return ms < CLEANER_IDLE_MS ? (long)ms : CLEANER_IDLE_MS;
+}
+
+// Keeps the dirty share of the pool under its limit so readers find clean
+// frames to evict. Below half the limit it idles; up to the limit it
+// trickles one round at a time; past it, it writes rounds back to back.
+// It warms the pool up first, and saves the manifest when it is due.
+static void* cleaner_main(void* arg) {
+    ObeliskBufferPool* pool = arg;
+    if (pool->warm_count > 0) warm_up(pool);
+
+    pthread_mutex_lock(&pool->cleaner_lock);
+    while (!pool->cleaner_stop) {
+        if (pool->manifest_interval_ns > 0 && now_ns() >= pool->next_manifest_ns) {
+            pthread_mutex_unlock(&pool->cleaner_lock);
+            buffer_pool_save_manifest(pool);
+            pool->next_manifest_ns = now_ns() + pool->manifest_interval_ns;
+            pthread_mutex_lock(&pool->cleaner_lock);
+        }
+
+        size_t limit = __atomic_load_n(&pool->dirty_limit, __ATOMIC_RELAXED);
+        size_t low = limit / 2;
+        size_t dirty = count_dirty(pool);
+        if (dirty <= low) {
+            cleaner_sleep(pool, idle_ms(pool));
+            continue;
+        }
+
+        pthread_mutex_unlock(&pool->cleaner_lock);
+        size_t cleaned = clean_round(pool);
+        pthread_mutex_lock(&pool->cleaner_lock);
+
+        // Pinned pages cannot be cleaned; wait for them rather than spin
+        if (pool->cleaner_stop || (dirty > limit && cleaned > 0)) continue;
+        cleaner_sleep(pool, CLEANER_TRICKLE_MS);
+    }
+    pthread_mutex_unlock(&pool->cleaner_lock);
+    return NULL;
+}
+
+void buffer_pool_destroy(ObeliskBufferPool* pool) {
+    if (!pool) return;
+
+    if (pool->cleaner_running) {
+        pthread_mutex_lock(&pool->cleaner_lock);
+        __atomic_store_n(&pool->cleaner_stop, true, __ATOMIC_RELAXED);
+        pthread_cond_signal(&pool->cleaner_wake);
+        pthread_mutex_unlock(&pool->cleaner_lock);
+        pthread_join(pool->cleaner, NULL);
+    }
+
+    // Dirty pages reach the data file before the frames go away, and the
+    // pages in them are listed for the next pool to warm up with
+    buffer_pool_flush_all(pool);
+    if (pool->manifest_file) buffer_pool_save_manifest(pool);
+    free_pool(pool);
 }
 
 int buffer_pool_prefetch_pages(ObeliskBufferPool* pool, uint64_t* page_ids, size_t count) {
     if (!pool || !page_ids) return -1;
 
-    for (size_t i = 0; i < count; i++) {
-        buffer_pool_get_page(pool, page_ids[i]);
+    // Memory-only pages read as zeros, so there is nothing worth waiting on
+    if (pool->fd < 0) {
+        for (size_t i = 0; i < count; i++) {
+            buffer_pool_get_page(pool, page_ids[i]);
+        }
+        return 0;
     }
 
+    // Reads are submitted here and finish in the background
+    prefetch_sharded(pool, page_ids, count);
     return 0;
 }
 
-ObeliskBufferPoolStats buffer_pool_get_stats(ObeliskBufferPool* pool) {
-    ObeliskBufferPoolStats stats = {0};
-    if (!pool) return stats;
+static void merge_latency(ObeliskLatencyHistogram* into, const ObeliskLatencyHistogram* from) {
+    for (int i = 0; i < OBELISK_LATENCY_BUCKETS; i++) {
+        into->buckets[i] += stat_read(&from->buckets[i]);
+    }
+    into->count += stat_read(&from->count);
+    into->total_ns += stat_read(&from->total_ns);
+    uint64_t max_ns = stat_read(&from->max_ns);
+    if (max_ns > into->max_ns) into->max_ns = max_ns;
+}
 
-    stats.hits = pool->hits;
-    stats.misses = pool->misses;
-    stats.evictions = pool->evictions;
-    stats.flushes = pool->flushes;
-    stats.hit_ratio = (double)pool->hits / (pool->hits + pool->misses);
+static void clear_latency(ObeliskLatencyHistogram* histogram) {
+    for (int i = 0; i < OBELISK_LATENCY_BUCKETS; i++) {
+        __atomic_store_n(&histogram->buckets[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&histogram->count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->total_ns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->max_ns, 0, __ATOMIC_RELAXED);
+}
 
-    return stats;
+void buffer_pool_snapshot(ObeliskBufferPool* pool, ObeliskBufferPoolSnapshot* snapshot) {
+    if (!snapshot) return;
+    memset(snapshot, 0, sizeof(*snapshot));
+    if (!pool) return;
+
+    ObeliskBufferPoolStats* stats = &snapshot->stats;
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        const ShardStats* shard = &pool->shards[i].stats;
+        stats->hits += stat_read(&shard->hits);
+        stats->misses += stat_read(&shard->misses);
+        stats->flushes += stat_read(&shard->flushes);
+        stats->foreground_writebacks += stat_read(&shard->foreground_writebacks);
+        stats->dirty_pages += __atomic_load_n(&pool->shards[i].dirty_count, __ATOMIC_RELAXED);
+        snapshot->victim_stalls += stat_read(&shard->victim_stalls);
+        for (int c = 0; c < OBELISK_PAGE_CLASS_COUNT; c++) {
+            snapshot->class_hits[c] += stat_read(&shard->class_hits[c]);
+            snapshot->class_misses[c] += stat_read(&shard->class_misses[c]);
+        }
+        for (int r = 0; r < OBELISK_EVICT_REASON_COUNT; r++) {
+            snapshot->evictions_by_reason[r] += stat_read(&shard->evictions[r]);
+        }
+        merge_latency(&snapshot->miss_latency, &shard->miss_latency);
+        merge_latency(&snapshot->flush_latency, &shard->flush_latency);
+    }
+    merge_latency(&snapshot->flush_latency, &pool->cleaner_latency);
+
+    for (int r = 0; r < OBELISK_EVICT_REASON_COUNT; r++) {
+        stats->evictions += snapshot->evictions_by_reason[r];
+    }
+    stats->cleaner_pages = __atomic_load_n(&pool->cleaner_pages, __ATOMIC_RELAXED);
+    stats->cleaner_writes = __atomic_load_n(&pool->cleaner_writes, __ATOMIC_RELAXED);
+    stats->warmed_pages = __atomic_load_n(&pool->warmed_pages, __ATOMIC_RELAXED);
+    uint64_t accesses = stats->hits + stats->misses;
+    stats->hit_ratio = accesses > 0 ? (double)stats->hits / (double)accesses : 0.0;
+}
+
+ObeliskBufferPoolStats buffer_pool_get_stats(ObeliskBufferPool* pool) {
+    ObeliskBufferPoolSnapshot snapshot;
+    buffer_pool_snapshot(pool, &snapshot);
+    return snapshot.stats;
 }
 
 void buffer_pool_reset_stats(ObeliskBufferPool* pool) {
     if (!pool) return;
 
-    pool->hits = 0;
-    pool->misses = 0;
-    pool->evictions = 0;
-    pool->flushes = 0;
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        PoolShard* shard = &pool->shards[i];
+        pthread_mutex_lock(&shard->latch);
+        ShardStats* stats = &shard->stats;
+        __atomic_store_n(&stats->hits, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->misses, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->flushes, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->foreground_writebacks, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->victim_stalls, 0, __ATOMIC_RELAXED);
+        for (int c = 0; c < OBELISK_PAGE_CLASS_COUNT; c++) {
+            __atomic_store_n(&stats->class_hits[c], 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&stats->class_misses[c], 0, __ATOMIC_RELAXED);
+        }
+        for (int r = 0; r < OBELISK_EVICT_REASON_COUNT; r++) {
+            __atomic_store_n(&stats->evictions[r], 0, __ATOMIC_RELAXED);
+        }
+        clear_latency(&stats->miss_latency);
+        clear_latency(&stats->flush_latency);
+        pthread_mutex_unlock(&shard->latch);
+    }
+
+    pthread_mutex_lock(&pool->flush_lock);
+    clear_latency(&pool->cleaner_latency);
+    pthread_mutex_unlock(&pool->flush_lock);
+    __atomic_store_n(&pool->cleaner_pages, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->cleaner_writes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->warmed_pages, 0, __ATOMIC_RELAXED);
+}
+
+uint64_t buffer_pool_latency_percentile(const ObeliskLatencyHistogram* histogram, double fraction) {
+    if (!histogram || histogram->count == 0) return 0;
+
+    double target = fraction * (double)histogram->count;
+    uint64_t rank = (uint64_t)target;
+    if ((double)rank < target) rank++;
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < OBELISK_LATENCY_BUCKETS - 1; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            uint64_t bound = 2ull << i;
+            return bound < histogram->max_ns ? bound : histogram->max_ns;
+        }
+    }
+    return histogram->max_ns;
+}
+
+static int compare_last_accessed(const void* a, const void* b, void* arg) {
+    ObeliskPage* const* frames = arg;
+    uint64_t x = frames[*(const uint32_t*)a]->last_accessed;
+    uint64_t y = frames[*(const uint32_t*)b]->last_accessed;
+    return (x > y) - (x < y);
+}
+
+// Swap in a replacer for policy with room for num_frames, replaying resident
+// pages oldest first so recency carries over; reference counts and history
+// start afresh
+static int rebuild_replacer(PoolShard* shard, ObeliskReplacementPolicy policy, size_t num_frames) {
+    ObeliskReplacer* replacer = replacer_create(policy, (uint32_t)num_frames);
+    uint32_t* frames = malloc(shard->num_frames * sizeof(uint32_t));
+    if (!replacer || (!frames && shard->num_frames > 0)) {
+        replacer_destroy(replacer);
+        free(frames);
+        return -1;
+    }
+
+    size_t count = 0;
+    for (uint32_t i = 0; i < shard->num_frames; i++) {
+        if (shard->frames[i]->is_valid) frames[count++] = i;
+    }
+    qsort_r(frames, count, sizeof(uint32_t), compare_last_accessed, shard->frames);
+    for (size_t i = 0; i < count; i++) {
+        replacer_admit(replacer, frames[i], shard->frames[frames[i]]->page_id);
+        replacer_touch(replacer, frames[i]);
+    }
+    free(frames);
+
+    replacer_destroy(shard->replacer);
+    shard->replacer = replacer;
+    return 0;
+}
+
+// Zeroed frames [first, first + count) of a shard, on the shard's node
+static FrameChunk* create_chunk(PoolShard* shard, size_t first, size_t count) {
+    ObeliskBufferPool* pool = shard->pool;
+    FrameChunk* chunk = calloc(1, sizeof(FrameChunk));
+    if (!chunk) return NULL;
+    chunk->first = first;
+    chunk->count = count;
+
+    chunk->pages = calloc(count, sizeof(ObeliskPage));
+    if (!chunk->pages ||
+        frame_memory_map(&chunk->memory, count * pool->page_size, pool->use_huge_pages, shard->node) != 0) {
+        free_chunk(chunk);
+        return NULL;
+    }
+    return chunk;
+}
+
+// realloc that leaves the array alone and sets *rc on failure
+static void* grow_array(void* array, size_t count, size_t size, int* rc) {
+    void* grown = realloc(array, count * size);
+    if (!grown) {
+        *rc = -1;
+        return array;
+    }
+    return grown;
+}
+
+// Make room in the per-frame arrays; they never shrink
+static int reserve_frames(PoolShard* shard, size_t frames) {
+    if (frames <= shard->capacity) return 0;
+
+    int rc = 0;
+    shard->frames = grow_array(shard->frames, frames, sizeof(ObeliskPage*), &rc);
+    shard->free_frames = grow_array(shard->free_frames, frames, sizeof(uint32_t), &rc);
+    shard->frame_io = grow_array(shard->frame_io, frames, sizeof(uint8_t), &rc);
+    shard->dirty_list = grow_array(shard->dirty_list, frames, sizeof(uint32_t), &rc);
+    shard->dirty_pos = grow_array(shard->dirty_pos, frames, sizeof(uint32_t), &rc);
+    shard->dirty_gen = grow_array(shard->dirty_gen, frames, sizeof(uint32_t), &rc);
+    shard->cleaning = grow_array(shard->cleaning, frames, sizeof(uint8_t), &rc);
+    if (rc == 0) shard->capacity = frames;
+    return rc;
+}
+
+// Add frames until the shard has target of them, refilling the unused tail
+// of its newest chunk before allocating another. The replacer is rebuilt
+// only when it has no room for them.
+static int grow_shard(PoolShard* shard, size_t target) {
+    ObeliskBufferPool* pool = shard->pool;
+    FrameChunk* top = shard->chunks;
+    size_t spare = top ? top->first + top->count - shard->num_frames : 0;
+
+    // Frame memory is allocated and zeroed before the latch is taken
+    FrameChunk* chunk = NULL;
+    if (target - shard->num_frames > spare) {
+        chunk = create_chunk(shard, shard->num_frames + spare, target - shard->num_frames - spare);
+        if (!chunk) return -1;
+    }
+
+    pthread_mutex_lock(&shard->latch);
+    int rc = reserve_frames(shard, target);
+    if (rc == 0 && (!shard->replacer || replacer_num_frames(shard->replacer) < target)) {
+        ObeliskReplacementPolicy policy = shard->replacer ? replacer_policy(shard->replacer) : pool->policy;
+        rc = rebuild_replacer(shard, policy, target);
+    }
+    if (rc != 0) {
+        pthread_mutex_unlock(&shard->latch);
+        if (chunk) free_chunk(chunk);
+        return -1;
+    }
+
+    if (chunk) {
+        chunk->next = shard->chunks;
+        shard->chunks = chunk;
+    }
+    for (size_t f = shard->num_frames; f < target; f++) {
+        FrameChunk* owner = chunk && f >= chunk->first ? chunk : top;
+        ObeliskPage* page = &owner->pages[f - owner->first];
+        page->data = (char*)owner->memory.base + (f - owner->first) * pool->page_size;
+        page->page_id = 0;
+        page->state = OBELISK_PAGE_CLEAN;
+        page->pin_count = 0;
+        page->last_accessed = 0;
+        page->is_valid = false;
+        page->page_class = OBELISK_PAGE_CLASS_OTHER;
+        page->frame = (uint32_t)f;
+        shard->frames[f] = page;
+        shard->frame_io[f] = FRAME_IO_NONE;
+        shard->dirty_gen[f] = 0;
+        shard->cleaning[f] = CLEANING_NONE;
+    }
+
+    // Lower frames are handed out first
+    for (size_t f = target; f > shard->num_frames; f--) {
+        shard->free_frames[shard->free_count++] = (uint32_t)(f - 1);
+    }
+    shard->num_frames = target;
+    shard->frame_limit = target;
+    shard->dirty_limit = (size_t)((1.0 - pool->clean_target) * (double)target);
+    pthread_mutex_unlock(&shard->latch);
+    return 0;
+}
+
+// Move a dirty page of a memory-only pool into a frame that stays, taking
+// the place of a clean page if none is free
+static int move_page(PoolShard* shard, ObeliskPage* page) {
+    uint64_t page_id = page->page_id;
+    ObeliskPage* dest = take_frame(shard, page_id, false);
+    if (!dest || install_page(shard, dest, page_id, page->page_class, OBELISK_EVICT_RESIZE) != 0) return -1;
+
+    memcpy(dest->data, page->data, shard->pool->page_size);
+    dest->last_accessed = page->last_accessed;
+    replacer_touch(shard->replacer, dest->frame);
+    mark_dirty(shard, dest);
+
+    // The page table already points at dest
+    replacer_remove(shard->replacer, page->frame);
+    mark_clean(shard, page);
+    page->is_valid = false;
+    return 0;
+}
+
+// Owners hold the address of a swizzled page, so one cannot be moved
+static int give_up_frame(PoolShard* shard, ObeliskPage* page) {
+    if (page->state == OBELISK_PAGE_DIRTY && shard->pool->fd < 0) {
+        return page->swizzled ? -1 : move_page(shard, page);
+    }
+
+    unswizzle_page(shard, page);
+    if (write_frame(shard, page) != 0) return -1;
+    drop_page(shard, page);
+    stat_add(&shard->stats.evictions[OBELISK_EVICT_RESIZE], 1);
+    return 0;
+}
+
+// Give up the frames from target on. Their pages are written back and
+// evicted as they come free, so the shard keeps serving while I/O in flight
+// is waited out. Pinned pages are waited for up to RESIZE_PIN_WAIT_MS, since
+// some (a tree's root, say) stay pinned for as long as their owner lives.
+// On failure every frame is kept.
+static int shrink_shard(PoolShard* shard, size_t target) {
+    ObeliskBufferPool* pool = shard->pool;
+    uint64_t deadline = now_ns() + RESIZE_PIN_WAIT_MS * 1000000ull;
+    pthread_mutex_lock(&shard->latch);
+    shard->frame_limit = target;
+
+    // Free frames past the limit are no longer handed out
+    size_t kept = 0;
+    for (size_t i = 0; i < shard->free_count; i++) {
+        if (shard->free_frames[i] < target) shard->free_frames[kept++] = shard->free_frames[i];
+    }
+    shard->free_count = kept;
+
+    int rc = 0;
+    for (;;) {
+        size_t busy = 0;
+        size_t pinned = 0;
+        for (size_t f = target; f < shard->num_frames && rc == 0; f++) {
+            ObeliskPage* page = shard->frames[f];
+            if (!page->is_valid) continue;
+            if (shard->frame_io[f] != FRAME_IO_NONE) {
+                busy++;
+                continue;
+            }
+            if (pin_count(page) > 0 || !owner_allows_eviction(pool, page)) {
+                pinned++;
+                continue;
+            }
+            rc = give_up_frame(shard, page);
+        }
+        if (rc != 0 || busy + pinned == 0) break;
+        if (busy == 0 && now_ns() >= deadline) {
+            rc = -1;
+            break;
+        }
+
+        reap_io(shard, false);
+        pthread_mutex_unlock(&shard->latch);
+        nanosleep(&(struct timespec){.tv_nsec = 1000000}, NULL);
+        pthread_mutex_lock(&shard->latch);
+    }
+
+    if (rc != 0) {
+        shard->frame_limit = shard->num_frames;
+        for (size_t f = target; f < shard->num_frames; f++) {
+            if (!shard->frames[f]->is_valid) release_frame(shard, (uint32_t)f);
+        }
+        pthread_mutex_unlock(&shard->latch);
+        return -1;
+    }
+
+    shard->num_frames = target;
+    shard->dirty_limit = (size_t)((1.0 - pool->clean_target) * (double)target);
+    FrameChunk* released = NULL;
+    while (shard->chunks && shard->chunks->first >= target) {
+        FrameChunk* chunk = shard->chunks;
+        shard->chunks = chunk->next;
+        chunk->next = released;
+        released = chunk;
+    }
+    FrameChunk* top = shard->chunks;
+    pthread_mutex_unlock(&shard->latch);
+
+    while (released) {
+        FrameChunk* chunk = released;
+        released = chunk->next;
+        free_chunk(chunk);
+    }
+
+    // A partly used chunk keeps its address range but returns the memory
+    // behind its unused tail; a later grow refills it
+    if (top && top->first + top->count > target) {
+        frame_memory_release(&top->memory, (target - top->first) * pool->page_size,
+                             (top->first + top->count - target) * pool->page_size);
+    }
+    return 0;
 }
 
 int buffer_pool_resize(ObeliskBufferPool* pool, size_t new_size) {
-    if (!pool || new_size == 0) return -1;
+    if (!pool || new_size == 0 || new_size >= PAGE_TABLE_NOT_FOUND) return -1;
+    if (new_size < pool->num_shards) return -1;  // Every shard keeps a frame
 
-    // TODO: Implement pool resizing
-    return -1;
+    // The cleaner writes frames without their shard latch, so it must not
+    // run while frames come and go
+    pthread_mutex_lock(&pool->flush_lock);
+    int rc = 0;
+    size_t total = 0;
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        PoolShard* shard = &pool->shards[i];
+        size_t target = new_size / pool->num_shards + (i < new_size % pool->num_shards);
+        if (rc == 0 && target > shard->num_frames) {
+            rc = grow_shard(shard, target);
+        } else if (rc == 0 && target < shard->num_frames) {
+            rc = shrink_shard(shard, target);
+        }
+        total += shard->num_frames;
+    }
+
+    __atomic_store_n(&pool->pool_size, total, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->dirty_limit, (size_t)((1.0 - pool->clean_target) * (double)total),
+                     __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&pool->flush_lock);
+    return rc;
+}
+
+static size_t shard_memory_usage(const PoolShard* shard, size_t page_size) {
+    size_t usage = shard->capacity * (sizeof(ObeliskPage*) + 4 * sizeof(uint32_t) + 2 * sizeof(uint8_t)) +
+                   (shard->page_table.mask + 1) * sizeof(ObeliskPageTableEntry) +
+                   replacer_memory_usage(shard->replacer);
+
+    // Only frames in use hold memory, unless a chunk's tail could not be
+    // handed back
+    for (const FrameChunk* chunk = shard->chunks; chunk; chunk = chunk->next) {
+        size_t data = chunk->memory.length;
+        if (!chunk->memory.hugetlb && chunk->first + chunk->count > shard->num_frames) {
+            data = (shard->num_frames - chunk->first) * page_size;
+        }
+        usage += sizeof(FrameChunk) + chunk->count * sizeof(ObeliskPage) + data;
+    }
+    return usage;
 }
 
 size_t buffer_pool_get_memory_usage(ObeliskBufferPool* pool) {
     if (!pool) return 0;
 
-    return pool->pool_size * pool->page_size + sizeof(ObeliskBufferPool);
+    size_t usage = sizeof(ObeliskBufferPool) + pool->num_shards * sizeof(PoolShard);
+    if (pool->fd >= 0) {
+        usage += CLEANER_BATCH * sizeof(CleanerCandidate) + CLEANER_MAX_RUN * sizeof(struct iovec);
+    }
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        PoolShard* shard = &pool->shards[i];
+        pthread_mutex_lock(&shard->latch);
+        usage += shard_memory_usage(shard, pool->page_size);
+        pthread_mutex_unlock(&shard->latch);
+    }
+    return usage;
 }
 
 int buffer_pool_set_policy(ObeliskBufferPool* pool, ObeliskReplacementPolicy policy) {
     if (!pool) return -1;
+    if (policy == pool->policy) return 0;
 
-    pool->policy = policy;
-    return 0;
-} 
\ No newline at end of file
+    int rc = 0;
+    for (size_t i = 0; i < pool->num_shards && rc == 0; i++) {
+        PoolShard* shard = &pool->shards[i];
+        pthread_mutex_lock(&shard->latch);
+        rc = rebuild_replacer(shard, policy, shard->num_frames);
+        pthread_mutex_unlock(&shard->latch);
+    }
+
+    if (rc == 0) pool->policy = policy;
+    return rc;
+}
@@ -0,0 +1,129 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "frame_memory.h"
+
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+#define NODE_MASK_BITS (8 * sizeof(unsigned long))
+
+static size_t round_up(size_t n, size_t to) {
+    return (n + to - 1) / to * to;
+}
+
+static size_t base_page_size(void) {
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? (size_t)size : 4096;
+}
+
+static void* map_anonymous(size_t length, int flags) {
+    void* base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    return base == MAP_FAILED ? NULL : base;
+}
+
+// Map length bytes starting on a huge page boundary, so transparent huge
+// pages can back all of it rather than just the aligned middle
+static void* map_huge_aligned(size_t length) {
+    size_t padded = length + HUGE_PAGE_SIZE;
+    char* raw = map_anonymous(padded, 0);
+    if (!raw) return NULL;
+
+    char* base = (char*)round_up((uintptr_t)raw, HUGE_PAGE_SIZE);
+    if (base > raw) munmap(raw, (size_t)(base - raw));
+    size_t tail = (size_t)(raw + padded - (base + length));
+    if (tail > 0) munmap(base + length, tail);
+
+#ifdef MADV_HUGEPAGE
+    madvise(base, length, MADV_HUGEPAGE);
+#endif
+    return base;
+}
+
+// Prefer node for pages not yet touched. Preferred rather than bound, so
+// a full node spills over to the others instead of failing the fault.
+static void place_on_node(void* base, size_t length, int node) {
+#ifdef SYS_mbind
+    if (node < 0 || node >= FRAME_MEMORY_MAX_NODES) return;
+    unsigned long mask[FRAME_MEMORY_MAX_NODES / NODE_MASK_BITS] = {0};
+    mask[node / NODE_MASK_BITS] |= 1ul << (node % NODE_MASK_BITS);
+    syscall(SYS_mbind, base, length, MPOL_PREFERRED, mask, FRAME_MEMORY_MAX_NODES + 1, 0);
+#else
+    (void)base;
+    (void)length;
+    (void)node;
+#endif
+}
+
+int frame_memory_map(ObeliskFrameMemory* memory, size_t bytes, bool huge_pages, int node) {
+    memset(memory, 0, sizeof(*memory));
+    if (bytes == 0) return -1;
+
+    // Huge pages only pay off for regions spanning several of them
+    if (huge_pages && bytes >= 2 * HUGE_PAGE_SIZE) {
+        size_t length = round_up(bytes, HUGE_PAGE_SIZE);
+#ifdef MAP_HUGETLB
+        memory->base = map_anonymous(length, MAP_HUGETLB);
+        memory->hugetlb = memory->base != NULL;
+#endif
+        if (!memory->base) memory->base = map_huge_aligned(length);
+        if (memory->base) memory->length = length;
+    }
+
+    if (!memory->base) {
+        size_t length = round_up(bytes, base_page_size());
+        memory->base = map_anonymous(length, 0);
+        if (!memory->base) return -1;
+        memory->length = length;
+    }
+
+    if (node != FRAME_MEMORY_NO_NODE) place_on_node(memory->base, memory->length, node);
+    return 0;
+}
+
+void frame_memory_unmap(ObeliskFrameMemory* memory) {
+    if (memory->base) munmap(memory->base, memory->length);
+    memory->base = NULL;
+    memory->length = 0;
+}
+
+bool frame_memory_release(ObeliskFrameMemory* memory, size_t offset, size_t length) {
+    if (memory->hugetlb) return false;
+
+    // Only whole pages inside the range can go
+    size_t page = base_page_size();
+    size_t start = round_up(offset, page);
+    size_t end = (offset + length) / page * page;
+    if (end > start) madvise((char*)memory->base + start, end - start, MADV_DONTNEED);
+    return true;
+}
+
+int frame_memory_numa_nodes(int* nodes, int max) {
+    int count = 0;
+    FILE* file = fopen("/sys/devices/system/node/online", "r");
+    if (file) {
+        // A list of ranges such as "0-3,6"
+        int first, last;
+        while (count < max && fscanf(file, "%d", &first) == 1) {
+            last = first;
+            int c = fgetc(file);
+            if (c == '-') {
+                if (fscanf(file, "%d", &last) != 1) break;
+                c = fgetc(file);
+            }
+            for (int node = first; node <= last && count < max; node++) {
+                nodes[count++] = node;
+            }
+            if (c != ',') break;
+        }
+        fclose(file);
+    }
+
+    if (count == 0 && max > 0) nodes[count++] = 0;
+    return count;
+}
@@ -0,0 +1,34 @@
+#ifndef OBELISK_FRAME_MEMORY_H
+#define OBELISK_FRAME_MEMORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Anonymous memory for buffer frames. Regions of a few megabytes or more
+// can be backed by 2 MB huge pages, reserved ones (hugetlbfs) if the system
+// has any and transparent ones otherwise, and can be placed on a NUMA node.
+// Whatever the system refuses falls back to ordinary pages and the default
+// placement. Fresh memory reads as zeros.
+
+#define FRAME_MEMORY_NO_NODE (-1)
+#define FRAME_MEMORY_MAX_NODES 64
+
+typedef struct {
+    void* base;      // Start of the region, aligned to at least a 4 KiB page
+    size_t length;   // Bytes mapped, rounded up to the page size in use
+    bool hugetlb;    // Reserved huge pages, which cannot be partly released
+} ObeliskFrameMemory;
+
+int frame_memory_map(ObeliskFrameMemory* memory, size_t bytes, bool huge_pages, int node);
+void frame_memory_unmap(ObeliskFrameMemory* memory);
+
+// Hand the pages behind [offset, offset + length) back to the system. The
+// range stays mapped and reads as zeros when next touched. Returns false if
+// the memory is kept, as it is for reserved huge pages.
+bool frame_memory_release(ObeliskFrameMemory* memory, size_t offset, size_t length);
+
+// Online NUMA node ids, at most max of them. A machine without NUMA reports
+// the single node 0.
+int frame_memory_numa_nodes(int* nodes, int max);
+
+#endif // OBELISK_FRAME_MEMORY_H
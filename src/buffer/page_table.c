@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include "page_table.h"
+
+#define PAGE_TABLE_MIN_CAPACITY 16
+
+// Fibonacci hashing spreads sequential page ids across the table
+static inline size_t page_table_slot(const ObeliskPageTable* table, uint64_t page_id) {
+    return (size_t)((page_id * 0x9E3779B97F4A7C15ull) >> 32) & table->mask;
+}
+
+static ObeliskPageTableEntry* alloc_entries(size_t capacity) {
+    ObeliskPageTableEntry* entries = malloc(capacity * sizeof(ObeliskPageTableEntry));
+    if (!entries) return NULL;
+
+    for (size_t i = 0; i < capacity; i++) {
+        entries[i].page_id = 0;
+        entries[i].frame = PAGE_TABLE_NOT_FOUND;
+    }
+    return entries;
+}
+
+int page_table_init(ObeliskPageTable* table, size_t expected_entries) {
+    if (!table) return -1;
+
+    size_t capacity = PAGE_TABLE_MIN_CAPACITY;
+    while (capacity < expected_entries * 2) capacity *= 2;
+
+    table->entries = alloc_entries(capacity);
+    if (!table->entries) return -1;
+    table->mask = capacity - 1;
+    table->count = 0;
+    return 0;
+}
+
+void page_table_destroy(ObeliskPageTable* table) {
+    if (!table) return;
+    free(table->entries);
+    table->entries = NULL;
+    table->mask = 0;
+    table->count = 0;
+}
+
+uint32_t page_table_find(const ObeliskPageTable* table, uint64_t page_id) {
+    size_t slot = page_table_slot(table, page_id);
+    for (;;) {
+        const ObeliskPageTableEntry* entry = &table->entries[slot];
+        if (entry->frame == PAGE_TABLE_NOT_FOUND) return PAGE_TABLE_NOT_FOUND;
+        if (entry->page_id == page_id) return entry->frame;
+        slot = (slot + 1) & table->mask;
+    }
+}
+
+static int page_table_grow(ObeliskPageTable* table) {
+    size_t old_capacity = table->mask + 1;
+    ObeliskPageTableEntry* old_entries = table->entries;
+
+    table->entries = alloc_entries(old_capacity * 2);
+    if (!table->entries) {
+        table->entries = old_entries;
+        return -1;
+    }
+    table->mask = old_capacity * 2 - 1;
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_entries[i].frame == PAGE_TABLE_NOT_FOUND) continue;
+
+        size_t slot = page_table_slot(table, old_entries[i].page_id);
+        while (table->entries[slot].frame != PAGE_TABLE_NOT_FOUND) {
+            slot = (slot + 1) & table->mask;
+        }
+        table->entries[slot] = old_entries[i];
+    }
+
+    free(old_entries);
+    return 0;
+}
+
+int page_table_insert(ObeliskPageTable* table, uint64_t page_id, uint32_t frame) {
+    if (!table || frame == PAGE_TABLE_NOT_FOUND) return -1;
+    if ((table->count + 1) * 2 > table->mask + 1 && page_table_grow(table) != 0) return -1;
+
+    size_t slot = page_table_slot(table, page_id);
+    for (;;) {
+        ObeliskPageTableEntry* entry = &table->entries[slot];
+        if (entry->frame == PAGE_TABLE_NOT_FOUND) {
+            entry->page_id = page_id;
+            entry->frame = frame;
+            table->count++;
+            return 0;
+        }
+        if (entry->page_id == page_id) {
+            entry->frame = frame;
+            return 0;
+        }
+        slot = (slot + 1) & table->mask;
+    }
+}
+
+bool page_table_remove(ObeliskPageTable* table, uint64_t page_id) {
+    if (!table) return false;
+
+    size_t slot = page_table_slot(table, page_id);
+    for (;;) {
+        ObeliskPageTableEntry* entry = &table->entries[slot];
+        if (entry->frame == PAGE_TABLE_NOT_FOUND) return false;
+        if (entry->page_id == page_id) break;
+        slot = (slot + 1) & table->mask;
+    }
+
+    // Backward-shift deletion: pull later entries of the cluster into the
+    // hole unless that would move them before their home slot
+    size_t hole = slot;
+    size_t next = (hole + 1) & table->mask;
+    while (table->entries[next].frame != PAGE_TABLE_NOT_FOUND) {
+        size_t home = page_table_slot(table, table->entries[next].page_id);
+        if (((next - home) & table->mask) >= ((next - hole) & table->mask)) {
+            table->entries[hole] = table->entries[next];
+            hole = next;
+        }
+        next = (next + 1) & table->mask;
+    }
+
+    table->entries[hole].page_id = 0;
+    table->entries[hole].frame = PAGE_TABLE_NOT_FOUND;
+    table->count--;
+    return true;
+}
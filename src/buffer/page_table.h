@@ -0,0 +1,36 @@
+#ifndef OBELISK_PAGE_TABLE_H
+#define OBELISK_PAGE_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Open-addressing hash table mapping page ids to frame indexes. Linear
+// probing keeps each lookup within one or two cache lines, and removals shift
+// later entries back instead of leaving tombstones, so probe sequences never
+// degrade. The table grows itself to stay at most half full.
+
+#define PAGE_TABLE_NOT_FOUND UINT32_MAX
+
+typedef struct {
+    uint64_t page_id;
+    uint32_t frame;  // PAGE_TABLE_NOT_FOUND marks an empty slot
+} ObeliskPageTableEntry;
+
+typedef struct {
+    ObeliskPageTableEntry* entries;
+    size_t mask;   // Capacity - 1; capacity is a power of two
+    size_t count;
+} ObeliskPageTable;
+
+int page_table_init(ObeliskPageTable* table, size_t expected_entries);
+void page_table_destroy(ObeliskPageTable* table);
+
+// Frame holding page_id, or PAGE_TABLE_NOT_FOUND
+uint32_t page_table_find(const ObeliskPageTable* table, uint64_t page_id);
+
+// Map page_id to frame, replacing any existing mapping
+int page_table_insert(ObeliskPageTable* table, uint64_t page_id, uint32_t frame);
+bool page_table_remove(ObeliskPageTable* table, uint64_t page_id);
+
+#endif // OBELISK_PAGE_TABLE_H
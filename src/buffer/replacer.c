@@ -0,0 +1,464 @@
+#include <stdlib.h>
+#include "replacer.h"
+#include "page_table.h"
+
+// Policies:
+//   LRU    evict the least recently referenced frame
+//   CLOCK  second-chance sweep over a reference bit per frame
+//   LFU    evict the least frequently referenced frame, oldest first on ties
+//   LRU-K  LRU-2 (O'Neil et al.): evict the frame whose second most recent
+//          reference is oldest; frames referenced once go first
+//   2Q     Johnson and Shasha's full 2Q: new pages wait in a FIFO and reach
+//          the LRU main list if they come back after leaving it, or are
+//          referenced again outside the correlated reference period
+//   ARC    Megiddo and Modha: balances recency against frequency, steered by
+//          hits on the history of recently evicted pages
+// The last three keep a one-off scan from flushing the hot working set.
+//
+// Lists and the heap are threaded through arrays indexed by node: nodes
+// [0, num_frames) are frames, the rest are history entries for evicted
+// pages ("ghosts"), found by page id through a page table.
+
+#define NIL UINT32_MAX
+
+// List roles; LRU uses only the first, 2Q the first three
+enum {
+    L_RECENT = 0,        // LRU list, 2Q A1in, ARC T1
+    L_FREQUENT,          // 2Q Am, ARC T2
+    L_GHOST_RECENT,      // 2Q A1out, ARC B1
+    L_GHOST_FREQUENT,    // ARC B2
+    NUM_LISTS,
+    L_NONE = 0xFF
+};
+
+typedef struct {
+    uint32_t head;  // Most recent
+    uint32_t tail;  // Least recent
+    uint32_t size;
+} NodeList;
+
+struct ObeliskReplacer {
+    ObeliskReplacementPolicy policy;
+    uint32_t num_frames;
+    uint32_t num_ghosts;
+    uint64_t tick;
+
+    // Per node
+    uint32_t* prev;
+    uint32_t* next;
+    uint8_t* list;
+    uint64_t* page_ids;
+    NodeList lists[NUM_LISTS];
+
+    // Per frame
+    bool* resident;
+    uint32_t* refs;      // Reference count; CLOCK's reference bit
+    uint64_t* last;      // Tick of the latest reference
+    uint64_t* prior;     // Tick of the one before it (LRU-K)
+    uint64_t* admitted;  // Tick the frame was admitted (2Q)
+
+    // History of evicted pages
+    ObeliskPageTable ghost_table;  // page_id -> node
+    uint32_t* free_ghosts;
+    uint32_t free_ghost_count;
+
+    uint32_t hand;        // CLOCK
+    uint32_t* heap;       // LFU, LRU-K: min-heap of frames
+    uint32_t* heap_pos;
+    uint32_t heap_size;
+    uint32_t target;      // ARC: target size of T1
+    uint32_t fifo_limit;  // 2Q: size of A1in before it gives up frames
+};
+
+// Intrusive lists
+
+static void list_push(ObeliskReplacer* r, int l, uint32_t node) {
+    NodeList* list = &r->lists[l];
+    r->prev[node] = NIL;
+    r->next[node] = list->head;
+    if (list->head != NIL) r->prev[list->head] = node;
+    list->head = node;
+    if (list->tail == NIL) list->tail = node;
+    list->size++;
+    r->list[node] = (uint8_t)l;
+}
+
+static void list_unlink(ObeliskReplacer* r, uint32_t node) {
+    NodeList* list = &r->lists[r->list[node]];
+    if (r->prev[node] != NIL) r->next[r->prev[node]] = r->next[node];
+    else list->head = r->next[node];
+    if (r->next[node] != NIL) r->prev[r->next[node]] = r->prev[node];
+    else list->tail = r->prev[node];
+    list->size--;
+    r->list[node] = L_NONE;
+}
+
+// Least recent frame of a list the pool can give up
+static uint32_t list_victim(ObeliskReplacer* r, int l, ObeliskEvictableFn evictable, void* ctx) {
+    for (uint32_t node = r->lists[l].tail; node != NIL; node = r->prev[node]) {
+        if (evictable(ctx, node)) return node;
+    }
+    return NIL;
+}
+
+// History of evicted pages
+
+static void ghost_drop(ObeliskReplacer* r, uint32_t node) {
+    page_table_remove(&r->ghost_table, r->page_ids[node]);
+    list_unlink(r, node);
+    r->free_ghosts[r->free_ghost_count++] = node;
+}
+
+static void ghost_trim(ObeliskReplacer* r, int l, uint32_t limit) {
+    while (r->lists[l].size > limit) ghost_drop(r, r->lists[l].tail);
+}
+
+static void ghost_add(ObeliskReplacer* r, int l, uint64_t page_id) {
+    if (r->free_ghost_count == 0) {
+        // Forget the oldest history first, frequent before recent
+        int victim = r->lists[L_GHOST_FREQUENT].size > 0 ? L_GHOST_FREQUENT : L_GHOST_RECENT;
+        ghost_drop(r, r->lists[victim].tail);
+    }
+
+    uint32_t node = r->free_ghosts[--r->free_ghost_count];
+    r->page_ids[node] = page_id;
+    page_table_insert(&r->ghost_table, page_id, node);  // Sized up front; cannot fail
+    list_push(r, l, node);
+}
+
+// Node remembering page_id, or NIL
+static uint32_t ghost_find(const ObeliskReplacer* r, uint64_t page_id) {
+    if (r->num_ghosts == 0) return NIL;
+    uint32_t node = page_table_find(&r->ghost_table, page_id);
+    return node == PAGE_TABLE_NOT_FOUND ? NIL : node;
+}
+
+// Min-heap of frames for LFU and LRU-K
+
+static bool heap_less(const ObeliskReplacer* r, uint32_t a, uint32_t b) {
+    uint64_t ka, kb;
+    if (r->policy == OBELISK_POLICY_LFU) {
+        ka = r->refs[a];
+        kb = r->refs[b];
+    } else {
+        // Backward 2-distance; frames referenced at most once sort first
+        ka = r->refs[a] >= 2 ? r->prior[a] + 1 : 0;
+        kb = r->refs[b] >= 2 ? r->prior[b] + 1 : 0;
+    }
+    if (ka != kb) return ka < kb;
+    return r->last[a] < r->last[b];
+}
+
+static void heap_set(ObeliskReplacer* r, uint32_t pos, uint32_t frame) {
+    r->heap[pos] = frame;
+    r->heap_pos[frame] = pos;
+}
+
+static void heap_sift_up(ObeliskReplacer* r, uint32_t pos) {
+    uint32_t frame = r->heap[pos];
+    while (pos > 0) {
+        uint32_t parent = (pos - 1) / 2;
+        if (!heap_less(r, frame, r->heap[parent])) break;
+        heap_set(r, pos, r->heap[parent]);
+        pos = parent;
+    }
+    heap_set(r, pos, frame);
+}
+
+static void heap_sift_down(ObeliskReplacer* r, uint32_t pos) {
+    uint32_t frame = r->heap[pos];
+    for (;;) {
+        uint32_t child = 2 * pos + 1;
+        if (child >= r->heap_size) break;
+        if (child + 1 < r->heap_size && heap_less(r, r->heap[child + 1], r->heap[child])) child++;
+        if (!heap_less(r, r->heap[child], frame)) break;
+        heap_set(r, pos, r->heap[child]);
+        pos = child;
+    }
+    heap_set(r, pos, frame);
+}
+
+static void heap_remove(ObeliskReplacer* r, uint32_t frame) {
+    uint32_t pos = r->heap_pos[frame];
+    uint32_t last = r->heap[--r->heap_size];
+    r->heap_pos[frame] = NIL;
+    if (pos == r->heap_size) return;
+
+    heap_set(r, pos, last);
+    heap_sift_up(r, pos);
+    heap_sift_down(r, r->heap_pos[last]);
+}
+
+static uint32_t heap_victim(ObeliskReplacer* r, ObeliskEvictableFn evictable, void* ctx) {
+    if (r->heap_size == 0) return NIL;
+    if (evictable(ctx, r->heap[0])) return r->heap[0];
+
+    // The minimum is pinned or busy, which is rare: settle for the best of
+    // the rest with a plain scan
+    uint32_t best = NIL;
+    for (uint32_t i = 1; i < r->heap_size; i++) {
+        uint32_t frame = r->heap[i];
+        if ((best == NIL || heap_less(r, frame, best)) && evictable(ctx, frame)) best = frame;
+    }
+    return best;
+}
+
+static uint32_t clock_victim(ObeliskReplacer* r, ObeliskEvictableFn evictable, void* ctx) {
+    // Two sweeps clear every reference bit; a third finds nothing new
+    for (uint64_t step = 0; step < 2 * (uint64_t)r->num_frames + 1; step++) {
+        uint32_t frame = r->hand;
+        r->hand = (r->hand + 1) % r->num_frames;
+        if (!r->resident[frame] || !evictable(ctx, frame)) continue;
+        if (r->refs[frame]) {
+            r->refs[frame] = 0;
+            continue;
+        }
+        return frame;
+    }
+    return NIL;
+}
+
+// Try list a, then list b
+static uint32_t lists_victim(ObeliskReplacer* r, int a, int b, ObeliskEvictableFn evictable, void* ctx) {
+    uint32_t frame = list_victim(r, a, evictable, ctx);
+    return frame != NIL ? frame : list_victim(r, b, evictable, ctx);
+}
+
+// Public interface
+
+void replacer_destroy(ObeliskReplacer* r) {
+    if (!r) return;
+    page_table_destroy(&r->ghost_table);
+    free(r->prev);
+    free(r->next);
+    free(r->list);
+    free(r->page_ids);
+    free(r->resident);
+    free(r->refs);
+    free(r->last);
+    free(r->prior);
+    free(r->admitted);
+    free(r->free_ghosts);
+    free(r->heap);
+    free(r->heap_pos);
+    free(r);
+}
+
+ObeliskReplacer* replacer_create(ObeliskReplacementPolicy policy, uint32_t num_frames) {
+    if (num_frames == 0 || num_frames == NIL) return NULL;
+    if (policy > OBELISK_POLICY_ARC) return NULL;
+
+    ObeliskReplacer* r = calloc(1, sizeof(ObeliskReplacer));
+    if (!r) return NULL;
+    r->policy = policy;
+    r->num_frames = num_frames;
+    r->fifo_limit = num_frames / 4 > 0 ? num_frames / 4 : 1;
+
+    // ARC remembers up to one pool's worth of evicted pages, 2Q half that
+    if (policy == OBELISK_POLICY_ARC) r->num_ghosts = num_frames;
+    if (policy == OBELISK_POLICY_2Q) r->num_ghosts = num_frames / 2 > 0 ? num_frames / 2 : 1;
+
+    size_t nodes = (size_t)num_frames + r->num_ghosts;
+    r->prev = malloc(nodes * sizeof(uint32_t));
+    r->next = malloc(nodes * sizeof(uint32_t));
+    r->list = malloc(nodes * sizeof(uint8_t));
+    r->page_ids = calloc(nodes, sizeof(uint64_t));
+    r->resident = calloc(num_frames, sizeof(bool));
+    r->refs = calloc(num_frames, sizeof(uint32_t));
+    r->last = calloc(num_frames, sizeof(uint64_t));
+    r->prior = calloc(num_frames, sizeof(uint64_t));
+    r->admitted = calloc(num_frames, sizeof(uint64_t));
+    r->heap = malloc(num_frames * sizeof(uint32_t));
+    r->heap_pos = malloc(num_frames * sizeof(uint32_t));
+    r->free_ghosts = malloc((r->num_ghosts ? r->num_ghosts : 1) * sizeof(uint32_t));
+    if (!r->prev || !r->next || !r->list || !r->page_ids || !r->resident || !r->refs ||
+        !r->last || !r->prior || !r->admitted || !r->heap || !r->heap_pos || !r->free_ghosts ||
+        page_table_init(&r->ghost_table, r->num_ghosts) != 0) {
+        replacer_destroy(r);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < nodes; i++) r->list[i] = L_NONE;
+    for (uint32_t i = 0; i < num_frames; i++) r->heap_pos[i] = NIL;
+    for (int l = 0; l < NUM_LISTS; l++) {
+        r->lists[l].head = NIL;
+        r->lists[l].tail = NIL;
+    }
+    for (uint32_t i = 0; i < r->num_ghosts; i++) {
+        r->free_ghosts[i] = num_frames + r->num_ghosts - 1 - i;
+    }
+    r->free_ghost_count = r->num_ghosts;
+
+    return r;
+}
+
+void replacer_admit(ObeliskReplacer* r, uint32_t frame, uint64_t page_id) {
+    if (r->resident[frame]) replacer_remove(r, frame);
+
+    r->resident[frame] = true;
+    r->page_ids[frame] = page_id;
+    r->refs[frame] = 0;
+    r->prior[frame] = 0;
+    r->last[frame] = ++r->tick;
+    r->admitted[frame] = r->tick;
+
+    switch (r->policy) {
+    case OBELISK_POLICY_LRU:
+        list_push(r, L_RECENT, frame);
+        break;
+    case OBELISK_POLICY_CLOCK:
+        break;
+    case OBELISK_POLICY_LFU:
+    case OBELISK_POLICY_LRU_K:
+        heap_set(r, r->heap_size++, frame);
+        heap_sift_up(r, r->heap_pos[frame]);
+        break;
+    case OBELISK_POLICY_2Q: {
+        // Pages that come back soon after leaving the FIFO have earned a
+        // place in the main list
+        uint32_t ghost = ghost_find(r, page_id);
+        if (ghost != NIL) {
+            ghost_drop(r, ghost);
+            list_push(r, L_FREQUENT, frame);
+        } else {
+            list_push(r, L_RECENT, frame);
+        }
+        break;
+    }
+    case OBELISK_POLICY_ARC: {
+        uint32_t ghost = ghost_find(r, page_id);
+        uint32_t b1 = r->lists[L_GHOST_RECENT].size;
+        uint32_t b2 = r->lists[L_GHOST_FREQUENT].size;
+
+        if (ghost != NIL && r->list[ghost] == L_GHOST_RECENT) {
+            // Evicted from T1 too early: favour recency
+            uint32_t delta = b2 > b1 ? b2 / b1 : 1;
+            r->target = r->target + delta < r->num_frames ? r->target + delta : r->num_frames;
+            ghost_drop(r, ghost);
+            list_push(r, L_FREQUENT, frame);
+        } else if (ghost != NIL) {
+            // Evicted from T2 too early: favour frequency
+            uint32_t delta = b1 > b2 ? b1 / b2 : 1;
+            r->target = r->target > delta ? r->target - delta : 0;
+            ghost_drop(r, ghost);
+            list_push(r, L_FREQUENT, frame);
+        } else {
+            list_push(r, L_RECENT, frame);
+        }
+
+        // |T1| + |B1| <= c and the whole directory <= 2c
+        uint32_t t1 = r->lists[L_RECENT].size;
+        ghost_trim(r, L_GHOST_RECENT, r->num_frames > t1 ? r->num_frames - t1 : 0);
+        uint32_t total = t1 + r->lists[L_FREQUENT].size + r->lists[L_GHOST_RECENT].size;
+        uint32_t limit = 2 * r->num_frames;
+        ghost_trim(r, L_GHOST_FREQUENT, limit > total ? limit - total : 0);
+        break;
+    }
+    }
+}
+
+void replacer_touch(ObeliskReplacer* r, uint32_t frame) {
+    if (!r->resident[frame]) return;
+
+    uint32_t refs = r->refs[frame];
+    r->prior[frame] = r->last[frame];
+    r->last[frame] = ++r->tick;
+    if (r->refs[frame] < UINT32_MAX) r->refs[frame]++;
+
+    switch (r->policy) {
+    case OBELISK_POLICY_LRU:
+        list_unlink(r, frame);
+        list_push(r, L_RECENT, frame);
+        break;
+    case OBELISK_POLICY_CLOCK:
+        r->refs[frame] = 1;
+        break;
+    case OBELISK_POLICY_LFU:
+    case OBELISK_POLICY_LRU_K:
+        heap_sift_down(r, r->heap_pos[frame]);  // Keys only grow
+        break;
+    case OBELISK_POLICY_2Q:
+        // Hits soon after admission are taken as correlated and ignored;
+        // the FIFO's length in ticks stands in for the period
+        if (r->list[frame] == L_FREQUENT || r->tick - r->admitted[frame] > r->fifo_limit) {
+            list_unlink(r, frame);
+            list_push(r, L_FREQUENT, frame);
+        }
+        break;
+    case OBELISK_POLICY_ARC:
+        // A second reference moves a page from T1 to T2
+        if (r->list[frame] == L_FREQUENT || refs > 0) {
+            list_unlink(r, frame);
+            list_push(r, L_FREQUENT, frame);
+        }
+        break;
+    }
+}
+
+void replacer_remove(ObeliskReplacer* r, uint32_t frame) {
+    if (!r->resident[frame]) return;
+
+    if (r->list[frame] != L_NONE) list_unlink(r, frame);
+    if (r->heap_pos[frame] != NIL) heap_remove(r, frame);
+    r->resident[frame] = false;
+}
+
+uint32_t replacer_victim(ObeliskReplacer* r, uint64_t incoming_page,
+                         ObeliskEvictableFn evictable, void* ctx) {
+    switch (r->policy) {
+    case OBELISK_POLICY_LRU:
+        return list_victim(r, L_RECENT, evictable, ctx);
+    case OBELISK_POLICY_CLOCK:
+        return clock_victim(r, evictable, ctx);
+    case OBELISK_POLICY_LFU:
+    case OBELISK_POLICY_LRU_K:
+        return heap_victim(r, evictable, ctx);
+    case OBELISK_POLICY_2Q:
+        if (r->lists[L_RECENT].size > r->fifo_limit) {
+            return lists_victim(r, L_RECENT, L_FREQUENT, evictable, ctx);
+        }
+        return lists_victim(r, L_FREQUENT, L_RECENT, evictable, ctx);
+    case OBELISK_POLICY_ARC: {
+        uint32_t t1 = r->lists[L_RECENT].size;
+        uint32_t ghost = ghost_find(r, incoming_page);
+        bool in_b2 = ghost != NIL && r->list[ghost] == L_GHOST_FREQUENT;
+        if (t1 > 0 && (t1 > r->target || (in_b2 && t1 == r->target))) {
+            return lists_victim(r, L_RECENT, L_FREQUENT, evictable, ctx);
+        }
+        return lists_victim(r, L_FREQUENT, L_RECENT, evictable, ctx);
+    }
+    }
+    return NIL;
+}
+
+void replacer_evict(ObeliskReplacer* r, uint32_t frame) {
+    if (!r->resident[frame]) return;
+
+    uint8_t list = r->list[frame];
+    uint64_t page_id = r->page_ids[frame];
+    replacer_remove(r, frame);
+
+    if (r->policy == OBELISK_POLICY_2Q && list == L_RECENT) {
+        ghost_add(r, L_GHOST_RECENT, page_id);
+    } else if (r->policy == OBELISK_POLICY_ARC) {
+        ghost_add(r, list == L_RECENT ? L_GHOST_RECENT : L_GHOST_FREQUENT, page_id);
+    }
+}
+
+ObeliskReplacementPolicy replacer_policy(const ObeliskReplacer* r) {
+    return r->policy;
+}
+
+uint32_t replacer_num_frames(const ObeliskReplacer* r) {
+    return r->num_frames;
+}
+
+size_t replacer_memory_usage(const ObeliskReplacer* r) {
+    if (!r) return 0;
+    size_t nodes = (size_t)r->num_frames + r->num_ghosts;
+    return sizeof(*r) +
+           nodes * (2 * sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint64_t)) +
+           r->num_frames * (sizeof(bool) + 3 * sizeof(uint32_t) + 3 * sizeof(uint64_t)) +
+           r->num_ghosts * sizeof(uint32_t) +
+           (r->ghost_table.mask + 1) * sizeof(ObeliskPageTableEntry);
+}
@@ -0,0 +1,41 @@
+#ifndef OBELISK_REPLACER_H
+#define OBELISK_REPLACER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <obelisk/buffer_pool.h>
+
+// Victim selection for the buffer pool's frames. The pool reports which
+// page each frame holds and every reference to it; the replacer picks the
+// frame to give up when the pool needs one and has none free.
+//
+// A frame enters with replacer_admit and is not referenced yet, so a page
+// that was only prefetched does not look hot. Frames leave with
+// replacer_evict, which remembers the page where the policy keeps history
+// (2Q and ARC), or with replacer_remove, which does not.
+
+#define REPLACER_NONE UINT32_MAX
+
+typedef struct ObeliskReplacer ObeliskReplacer;
+
+// Whether the pool can give up a frame right now (unpinned, no I/O, ...)
+typedef bool (*ObeliskEvictableFn)(void* ctx, uint32_t frame);
+
+ObeliskReplacer* replacer_create(ObeliskReplacementPolicy policy, uint32_t num_frames);
+void replacer_destroy(ObeliskReplacer* replacer);
+
+void replacer_admit(ObeliskReplacer* replacer, uint32_t frame, uint64_t page_id);
+void replacer_touch(ObeliskReplacer* replacer, uint32_t frame);
+void replacer_remove(ObeliskReplacer* replacer, uint32_t frame);
+
+// Choose the frame to reuse for incoming_page, or REPLACER_NONE if no
+// admitted frame is evictable. The frame stays admitted until evicted.
+uint32_t replacer_victim(ObeliskReplacer* replacer, uint64_t incoming_page,
+                         ObeliskEvictableFn evictable, void* ctx);
+void replacer_evict(ObeliskReplacer* replacer, uint32_t frame);
+
+ObeliskReplacementPolicy replacer_policy(const ObeliskReplacer* replacer);
+uint32_t replacer_num_frames(const ObeliskReplacer* replacer);
+size_t replacer_memory_usage(const ObeliskReplacer* replacer);
+
+#endif // OBELISK_REPLACER_H
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "warm_manifest.h"
+
+#define MANIFEST_MAGIC 0x4F424C4B57524D31ULL
+#define MANIFEST_VERSION 1
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t page_size;
+    uint64_t count;
+} ManifestHeader;
+
+static int write_all(int fd, const void* buf, size_t len) {
+    const char* p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void* buf, size_t len) {
+    char* p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int warm_manifest_save(const char* path, size_t page_size, const uint64_t* page_ids, size_t count) {
+    size_t len = strlen(path);
+    char* tmp = malloc(len + sizeof(".tmp"));
+    if (!tmp) return -1;
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, ".tmp", sizeof(".tmp"));
+
+    // Written aside and renamed over the old list once durable
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(tmp);
+        return -1;
+    }
+
+    ManifestHeader header = {
+        .magic = MANIFEST_MAGIC,
+        .version = MANIFEST_VERSION,
+        .page_size = page_size,
+        .count = count,
+    };
+    int rc = write_all(fd, &header, sizeof(header));
+    if (rc == 0) rc = write_all(fd, page_ids, count * sizeof(uint64_t));
+    if (rc == 0) rc = fsync(fd);
+    if (close(fd) != 0) rc = -1;
+    if (rc == 0) rc = rename(tmp, path);
+    if (rc != 0) unlink(tmp);
+    free(tmp);
+    return rc == 0 ? 0 : -1;
+}
+
+uint64_t* warm_manifest_load(const char* path, size_t page_size, size_t max, size_t* count) {
+    *count = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    ManifestHeader header;
+    uint64_t* page_ids = NULL;
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size < (off_t)sizeof(header) || lseek(fd, 0, SEEK_SET) != 0 ||
+        read_all(fd, &header, sizeof(header)) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // A list cut short or written by another layout is ignored outright
+    uint64_t body = (uint64_t)(size - (off_t)sizeof(header));
+    if (header.magic != MANIFEST_MAGIC || header.version != MANIFEST_VERSION ||
+        header.page_size != page_size || body % sizeof(uint64_t) != 0 ||
+        header.count != body / sizeof(uint64_t)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t n = header.count < max ? (size_t)header.count : max;
+    if (n > 0) page_ids = malloc(n * sizeof(uint64_t));
+    if (page_ids && read_all(fd, page_ids, n * sizeof(uint64_t)) != 0) {
+        free(page_ids);
+        page_ids = NULL;
+    }
+    close(fd);
+
+    if (page_ids) *count = n;
+    return page_ids;
+}
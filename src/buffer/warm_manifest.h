@@ -0,0 +1,19 @@
+#ifndef OBELISK_WARM_MANIFEST_H
+#define OBELISK_WARM_MANIFEST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The list of page ids a buffer pool held, hottest first, kept so a
+// restarted pool can read its working set back in bulk rather than one miss
+// at a time. The file is replaced atomically, so a crash mid-save leaves
+// the previous list in place.
+
+int warm_manifest_save(const char* path, size_t page_size, const uint64_t* page_ids, size_t count);
+
+// At most max page ids, hottest first, in a malloc'd array. Returns NULL
+// with *count 0 if there is no usable list: none was saved, it is damaged,
+// or it was written for another page size.
+uint64_t* warm_manifest_load(const char* path, size_t page_size, size_t max, size_t* count);
+
+#endif // OBELISK_WARM_MANIFEST_H
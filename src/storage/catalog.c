@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <string.h>
+#include "catalog.h"
+
+#define CATALOG_INITIAL_BUCKETS 16
+
+static size_t hash_name(const char* name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ull;
+    }
+    return (size_t)hash;
+}
+
+static void free_table(CatalogTable* table) {
+    free(table->name);
+    free(table->tail);
+    free(table->page);
+    free(table->body);
+    free(table);
+}
+
+int catalog_init(Catalog* catalog) {
+    catalog->buckets = calloc(CATALOG_INITIAL_BUCKETS, sizeof(CatalogTable*));
+    catalog->num_buckets = CATALOG_INITIAL_BUCKETS;
+    catalog->count = 0;
+    return catalog->buckets ? 0 : -1;
+}
+
+void catalog_destroy(Catalog* catalog) {
+    for (size_t i = 0; i < catalog->num_buckets; i++) {
+        CatalogTable* table = catalog->buckets[i];
+        while (table) {
+            CatalogTable* next = table->next;
+            free_table(table);
+            table = next;
+        }
+    }
+    free(catalog->buckets);
+    catalog->buckets = NULL;
+    catalog->num_buckets = 0;
+    catalog->count = 0;
+}
+
+CatalogTable* catalog_find(const Catalog* catalog, const char* name) {
+    CatalogTable* table = catalog->buckets[hash_name(name) & (catalog->num_buckets - 1)];
+    while (table && strcmp(table->name, name) != 0) {
+        table = table->next;
+    }
+    return table;
+}
+
+// Double the buckets once there are more tables than buckets. A failed
+// grow only leaves the chains longer.
+static void grow(Catalog* catalog) {
+    size_t num_buckets = catalog->num_buckets * 2;
+    CatalogTable** buckets = calloc(num_buckets, sizeof(CatalogTable*));
+    if (!buckets) return;
+
+    for (size_t i = 0; i < catalog->num_buckets; i++) {
+        CatalogTable* table = catalog->buckets[i];
+        while (table) {
+            CatalogTable* next = table->next;
+            size_t b = hash_name(table->name) & (num_buckets - 1);
+            table->next = buckets[b];
+            buckets[b] = table;
+            table = next;
+        }
+    }
+    free(catalog->buckets);
+    catalog->buckets = buckets;
+    catalog->num_buckets = num_buckets;
+}
+
+CatalogTable* catalog_add(Catalog* catalog, const char* name, size_t page_size) {
+    CatalogTable* table = calloc(1, sizeof(CatalogTable));
+    if (!table) return NULL;
+
+    table->fd = -1;
+    table->name = strdup(name);
+    table->tail = malloc(page_size);
+    table->page = malloc(page_size);
+    table->body = malloc(page_size);
+    if (!table->name || !table->tail || !table->page || !table->body) {
+        free_table(table);
+        return NULL;
+    }
+
+    if (catalog->count >= catalog->num_buckets) grow(catalog);
+    size_t b = hash_name(name) & (catalog->num_buckets - 1);
+    table->next = catalog->buckets[b];
+    catalog->buckets[b] = table;
+    catalog->count++;
+    return table;
+}
+
+void catalog_remove(Catalog* catalog, CatalogTable* table) {
+    CatalogTable** link = &catalog->buckets[hash_name(table->name) & (catalog->num_buckets - 1)];
+    while (*link && *link != table) {
+        link = &(*link)->next;
+    }
+    if (!*link) return;
+
+    *link = table->next;
+    catalog->count--;
+    free_table(table);
+}
+
+int catalog_for_each(Catalog* catalog, int (*fn)(CatalogTable* table, void* ctx), void* ctx) {
+    for (size_t i = 0; i < catalog->num_buckets; i++) {
+        for (CatalogTable* table = catalog->buckets[i]; table; table = table->next) {
+            int rc = fn(table, ctx);
+            if (rc != 0) return rc;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef OBELISK_CATALOG_H
+#define OBELISK_CATALOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Tables the storage engine has open, by name. Each keeps its file open,
+// its metadata in memory and a copy of its last heap page, so an insert
+// writes one page and nothing else; the metadata reaches the file at
+// checkpoints.
+
+// Page 0 of a table file. A table whose metadata is not marked clean was
+// changed after its last checkpoint and is recounted when next opened.
+#define TABLE_META_MAGIC 0x4F424C4B54424C31ULL
+#define TABLE_META_CLEAN 0x1
+
+typedef struct {
+    uint64_t magic;
+    uint32_t num_columns;
+    uint32_t record_size;
+    uint64_t num_records;
+    uint64_t first_page;
+    uint64_t last_page;
+    uint64_t flags;
+} TableMeta;
+
+typedef struct CatalogTable {
+    char* name;
+    int fd;
+    TableMeta meta;
+    bool meta_dirty;              // meta is ahead of page 0
+    char* tail;                   // Copy of page meta.last_page, when there is one
+    char* page;                   // Scratch page
+    char* body;                   // Scratch record body
+    struct CatalogTable* next;    // Hash chain
+} CatalogTable;
+
+typedef struct {
+    CatalogTable** buckets;
+    size_t num_buckets;           // A power of two
+    size_t count;
+} Catalog;
+
+int catalog_init(Catalog* catalog);
+
+// Frees every entry; their files must already be closed
+void catalog_destroy(Catalog* catalog);
+
+CatalogTable* catalog_find(const Catalog* catalog, const char* name);
+
+// A new entry for name with its buffers allocated and no file (fd -1)
+CatalogTable* catalog_add(Catalog* catalog, const char* name, size_t page_size);
+void catalog_remove(Catalog* catalog, CatalogTable* table);
+
+// Call fn on every entry, stopping at the first that returns nonzero
+int catalog_for_each(Catalog* catalog, int (*fn)(CatalogTable* table, void* ctx), void* ctx);
+
+#endif // OBELISK_CATALOG_H
@@ -0,0 +1,120 @@
+#include <stdint.h>
+#include <string.h>
+#include "page_codec.h"
+
+#define MIN_MATCH 4
+#define HASH_BITS 12
+#define MAX_INPUT 65536  // Offsets are 16 bits, as are the hash table's positions
+
+static uint32_t hash4(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths that do not fit a token nibble continue in bytes of 255 and a
+// final byte below 255
+static uint8_t* put_length(uint8_t* out, uint8_t* end, size_t n) {
+    for (; n >= 255; n -= 255) {
+        if (out == end) return NULL;
+        *out++ = 255;
+    }
+    if (out == end) return NULL;
+    *out++ = (uint8_t)n;
+    return out;
+}
+
+static int get_length(const uint8_t** in, const uint8_t* end, size_t* n) {
+    uint8_t byte;
+    do {
+        if (*in == end) return -1;
+        byte = *(*in)++;
+        *n += byte;
+    } while (byte == 255);
+    return 0;
+}
+
+// A match_len of 0 writes the closing, literals-only sequence
+static uint8_t* put_sequence(uint8_t* out, uint8_t* end, const uint8_t* literals, size_t num_literals,
+                             size_t offset, size_t match_len) {
+    if (out == end) return NULL;
+    size_t match_code = match_len ? match_len - MIN_MATCH : 0;
+    *out++ = (uint8_t)((num_literals < 15 ? num_literals : 15) << 4 | (match_code < 15 ? match_code : 15));
+
+    if (num_literals >= 15 && !(out = put_length(out, end, num_literals - 15))) return NULL;
+    if ((size_t)(end - out) < num_literals) return NULL;
+    memcpy(out, literals, num_literals);
+    out += num_literals;
+    if (match_len == 0) return out;
+
+    if (end - out < 2) return NULL;
+    *out++ = (uint8_t)(offset & 0xFF);
+    *out++ = (uint8_t)(offset >> 8);
+    if (match_code >= 15 && !(out = put_length(out, end, match_code - 15))) return NULL;
+    return out;
+}
+
+size_t page_codec_compress(const void* src, size_t len, void* dst, size_t capacity) {
+    const uint8_t* in = src;
+    uint8_t* out = dst;
+    uint8_t* end = out + capacity;
+    if (len > MAX_INPUT) return 0;
+
+    // Positions by the hash of the four bytes there; a stale or colliding
+    // entry only costs a failed comparison
+    uint16_t table[1 << HASH_BITS] = {0};
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + MIN_MATCH <= len) {
+        uint32_t h = hash4(in + pos);
+        size_t candidate = table[h];
+        table[h] = (uint16_t)pos;
+        if (candidate >= pos || memcmp(in + candidate, in + pos, MIN_MATCH) != 0) {
+            // Stride faster through bytes that keep failing to match
+            pos += 1 + ((pos - anchor) >> 6);
+            continue;
+        }
+
+        size_t match = MIN_MATCH;
+        while (pos + match < len && in[candidate + match] == in[pos + match]) match++;
+        out = put_sequence(out, end, in + anchor, pos - anchor, pos - candidate, match);
+        if (!out) return 0;
+        pos += match;
+        anchor = pos;
+    }
+
+    out = put_sequence(out, end, in + anchor, len - anchor, 0, 0);
+    return out ? (size_t)(out - (uint8_t*)dst) : 0;
+}
+
+int page_codec_decompress(const void* src, size_t len, void* dst, size_t out_len) {
+    const uint8_t* in = src;
+    const uint8_t* in_end = in + len;
+    uint8_t* out = dst;
+    uint8_t* out_end = out + out_len;
+
+    while (in < in_end) {
+        uint8_t token = *in++;
+        size_t num_literals = token >> 4;
+        if (num_literals == 15 && get_length(&in, in_end, &num_literals) != 0) return -1;
+        if ((size_t)(in_end - in) < num_literals || (size_t)(out_end - out) < num_literals) return -1;
+        memcpy(out, in, num_literals);
+        in += num_literals;
+        out += num_literals;
+        if (in == in_end) break;
+
+        if (in_end - in < 2) return -1;
+        size_t offset = (size_t)in[0] | (size_t)in[1] << 8;
+        in += 2;
+        size_t match = token & 15;
+        if (match == 15 && get_length(&in, in_end, &match) != 0) return -1;
+        match += MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(out - (uint8_t*)dst) || (size_t)(out_end - out) < match) return -1;
+
+        // Byte by byte, since a match may overlap what it is copying
+        const uint8_t* from = out - offset;
+        for (size_t i = 0; i < match; i++) out[i] = from[i];
+        out += match;
+    }
+    return out == out_end ? 0 : -1;
+}
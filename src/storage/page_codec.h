@@ -0,0 +1,20 @@
+#ifndef OBELISK_PAGE_CODEC_H
+#define OBELISK_PAGE_CODEC_H
+
+#include <stddef.h>
+
+// A small LZ77 codec for pages, in the LZ4 mould: each sequence is a token
+// holding a literal count and a match length, the literals, then a 16-bit
+// back offset and the rest of the match length. The last sequence has
+// literals only. It favours speed over ratio; text-heavy pages still
+// shrink two to four times.
+
+// Compress len bytes (at most 64 KiB) into dst. Returns the compressed
+// length, or 0 if it would take more than capacity bytes.
+size_t page_codec_compress(const void* src, size_t len, void* dst, size_t capacity);
+
+// Returns -1 unless src decodes to exactly out_len bytes. Damaged input is
+// refused, never read or written out of bounds.
+int page_codec_decompress(const void* src, size_t len, void* dst, size_t out_len);
+
+#endif // OBELISK_PAGE_CODEC_H
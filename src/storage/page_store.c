@@ -0,0 +1,389 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "page_store.h"
+#include "page_codec.h"
+
+#define MAP_MAGIC 0x4F424C4B50474D31ULL
+#define MAP_VERSION 2
+
+// The map file: this header, num_chunks chunks that hold a page, each its
+// index followed by its PAGE_STORE_CHUNK PageExtents, then num_free free
+// extents, each its first sector << 6 | its sector count
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t page_size;
+    uint64_t end_sector;
+    uint64_t num_chunks;
+    uint64_t num_free;
+} MapHeader;
+
+#define CHUNK_BYTES (PAGE_STORE_CHUNK * sizeof(PageExtent))
+#define CHUNK_RECORD (sizeof(uint64_t) + CHUNK_BYTES)
+
+#define FREE_SHIFT 6
+#define FREE_COUNT_MASK ((1u << FREE_SHIFT) - 1)
+
+static char* join_path(const char* directory, const char* name) {
+    size_t dir_len = strlen(directory);
+    size_t name_len = strlen(name) + 1;
+    char* path = malloc(dir_len + 1 + name_len);
+    if (!path) return NULL;
+    memcpy(path, directory, dir_len);
+    path[dir_len] = '/';
+    memcpy(path + dir_len + 1, name, name_len);
+    return path;
+}
+
+static size_t sectors_for(size_t length) {
+    return (length + PAGE_STORE_SECTOR - 1) / PAGE_STORE_SECTOR;
+}
+
+static int list_reserve(ExtentList* list) {
+    if (list->count < list->capacity) return 0;
+    size_t capacity = list->capacity ? list->capacity * 2 : 16;
+    uint64_t* sectors = realloc(list->sectors, capacity * sizeof(uint64_t));
+    if (!sectors) return -1;
+    list->sectors = sectors;
+    list->capacity = capacity;
+    return 0;
+}
+
+static int list_push(ExtentList* list, uint64_t sector) {
+    if (list_reserve(list) != 0) return -1;
+    list->sectors[list->count++] = sector;
+    return 0;
+}
+
+// The extent of page_id, or NULL if none was ever written there. With
+// create, the chunk holding it is allocated as needed.
+static PageExtent* extent_of(PageStore* store, uint64_t page_id, bool create) {
+    if (page_id >= OBELISK_STORAGE_MAX_PAGES) return NULL;
+    size_t chunk = (size_t)(page_id / PAGE_STORE_CHUNK);
+    if (chunk >= store->num_chunks || !store->chunks[chunk]) {
+        if (!create) return NULL;
+        if (chunk >= store->num_chunks) {
+            size_t num_chunks = store->num_chunks ? store->num_chunks * 2 : 16;
+            while (num_chunks <= chunk) num_chunks *= 2;
+            if (num_chunks > PAGE_STORE_MAX_CHUNKS) num_chunks = PAGE_STORE_MAX_CHUNKS;
+
+            PageExtent** chunks = realloc(store->chunks, num_chunks * sizeof(PageExtent*));
+            if (!chunks) return NULL;
+            memset(chunks + store->num_chunks, 0, (num_chunks - store->num_chunks) * sizeof(PageExtent*));
+            store->chunks = chunks;
+            store->num_chunks = num_chunks;
+        }
+        store->chunks[chunk] = calloc(PAGE_STORE_CHUNK, sizeof(PageExtent));
+        if (!store->chunks[chunk]) return NULL;
+    }
+    return &store->chunks[chunk][page_id % PAGE_STORE_CHUNK];
+}
+
+static void free_chunks(PageStore* store) {
+    for (size_t i = 0; i < store->num_chunks; i++) free(store->chunks[i]);
+    free(store->chunks);
+    store->chunks = NULL;
+    store->num_chunks = 0;
+}
+
+static int write_all(int fd, const void* buf, size_t len) {
+    const char* p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void* buf, size_t len) {
+    char* p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int page_store_init(PageStore* store, const char* directory, size_t page_size, bool compress) {
+    memset(store, 0, sizeof(PageStore));
+    store->fd = -1;
+    store->page_size = page_size;
+    store->compress = compress;
+    store->directory = strdup(directory);
+    store->data_path = join_path(directory, "pages.store");
+    store->map_path = join_path(directory, "pages.map");
+    store->buffer = malloc(page_size);
+    if (!store->directory || !store->data_path || !store->map_path || !store->buffer) {
+        page_store_destroy(store);
+        return -1;
+    }
+    return 0;
+}
+
+void page_store_destroy(PageStore* store) {
+    if (store->fd >= 0) close(store->fd);
+    for (size_t i = 0; i <= PAGE_STORE_MAX_SECTORS; i++) {
+        free(store->free[i].sectors);
+        free(store->released[i].sectors);
+    }
+    free_chunks(store);
+    free(store->buffer);
+    free(store->directory);
+    free(store->data_path);
+    free(store->map_path);
+    memset(store, 0, sizeof(PageStore));
+    store->fd = -1;
+}
+
+// Take in the map saved by the last checkpoint. A missing map is an empty
+// store; a damaged one, or one written for another page size, is refused.
+static int load_map(PageStore* store) {
+    int fd = open(store->map_path, O_RDONLY);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
+
+    MapHeader header;
+    char* body = NULL;
+    off_t size = lseek(fd, 0, SEEK_END);
+    int rc = size >= (off_t)sizeof(header) && lseek(fd, 0, SEEK_SET) == 0 &&
+             read_all(fd, &header, sizeof(header)) == 0 ? 0 : -1;
+
+    uint64_t body_size = rc == 0 ? (uint64_t)(size - (off_t)sizeof(header)) : 0;
+    if (rc == 0 && (header.magic != MAP_MAGIC || header.version != MAP_VERSION ||
+                    header.page_size != store->page_size ||
+                    header.num_chunks > body_size / CHUNK_RECORD ||
+                    header.num_free > body_size / sizeof(uint64_t) ||
+                    body_size != header.num_chunks * CHUNK_RECORD + header.num_free * sizeof(uint64_t))) {
+        rc = -1;
+    }
+    if (rc == 0 && body_size > 0) {
+        body = malloc((size_t)body_size);
+        rc = body && read_all(fd, body, (size_t)body_size) == 0 ? 0 : -1;
+    }
+    close(fd);
+
+    // Every extent must lie within the sectors handed out
+    for (uint64_t i = 0; rc == 0 && i < header.num_chunks; i++) {
+        const char* record = body + i * CHUNK_RECORD;
+        uint64_t chunk;
+        memcpy(&chunk, record, sizeof(chunk));
+        PageExtent* extents = chunk < PAGE_STORE_MAX_CHUNKS ? extent_of(store, chunk * PAGE_STORE_CHUNK, true) : NULL;
+        if (!extents) {
+            rc = -1;
+            break;
+        }
+        memcpy(extents, record + sizeof(chunk), CHUNK_BYTES);
+        for (size_t j = 0; j < PAGE_STORE_CHUNK; j++) {
+            if (extents[j].length > store->page_size ||
+                (extents[j].length && extents[j].sector + sectors_for(extents[j].length) > header.end_sector)) {
+                rc = -1;
+            }
+        }
+    }
+    const char* free_entries = body ? body + header.num_chunks * CHUNK_RECORD : NULL;
+    for (uint64_t i = 0; rc == 0 && i < header.num_free; i++) {
+        uint64_t entry;
+        memcpy(&entry, free_entries + i * sizeof(entry), sizeof(entry));
+        size_t count = (size_t)(entry & FREE_COUNT_MASK);
+        uint64_t sector = entry >> FREE_SHIFT;
+        if (count == 0 || count > PAGE_STORE_MAX_SECTORS || sector + count > header.end_sector) rc = -1;
+        if (rc == 0) rc = list_push(&store->free[count], sector);
+    }
+    free(body);
+
+    if (rc == 0) store->end_sector = header.end_sector;
+    return rc;
+}
+
+static int open_store(PageStore* store) {
+    if (store->fd >= 0) return 0;
+
+    store->fd = open(store->data_path, O_RDWR | O_CREAT, 0644);
+    if (store->fd < 0) return -1;
+    if (load_map(store) != 0) {
+        // Nothing half loaded is kept
+        free_chunks(store);
+        for (size_t i = 0; i <= PAGE_STORE_MAX_SECTORS; i++) store->free[i].count = 0;
+        close(store->fd);
+        store->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+static uint64_t allocate_extent(PageStore* store, size_t sectors) {
+    ExtentList* list = &store->free[sectors];
+    if (list->count > 0) return list->sectors[--list->count];
+
+    uint64_t sector = store->end_sector;
+    store->end_sector += sectors;
+    return sector;
+}
+
+int page_store_write(PageStore* store, uint64_t page_id, const void* data) {
+    if (page_id >= OBELISK_STORAGE_MAX_PAGES || open_store(store) != 0) return -1;
+    PageExtent* extent = extent_of(store, page_id, true);
+    if (!extent) return -1;
+
+    // Compressed only when that saves at least a sector
+    const void* stored = data;
+    size_t length = store->page_size;
+    uint16_t flags = 0;
+    if (store->compress) {
+        size_t capacity = (sectors_for(store->page_size) - 1) * PAGE_STORE_SECTOR;
+        size_t compressed = page_codec_compress(data, store->page_size, store->buffer, capacity);
+        if (compressed > 0) {
+            stored = store->buffer;
+            length = compressed;
+            flags = PAGE_EXTENT_COMPRESSED;
+        }
+    }
+
+    // The old extent must stay intact until a checkpoint saves a map
+    // without it, so there has to be room to note it as released
+    ExtentList* released = extent->length ? &store->released[sectors_for(extent->length)] : NULL;
+    if (released && list_reserve(released) != 0) return -1;
+
+    size_t sectors = sectors_for(length);
+    uint64_t sector = allocate_extent(store, sectors);
+    off_t offset = (off_t)(sector * PAGE_STORE_SECTOR);
+    if (pwrite(store->fd, stored, length, offset) != (ssize_t)length) {
+        // Popped extents have their slot still there; new ones come off the end
+        if (sector + sectors == store->end_sector) {
+            store->end_sector = sector;
+        } else {
+            store->free[sectors].sectors[store->free[sectors].count++] = sector;
+        }
+        return -1;
+    }
+
+    if (released) list_push(released, extent->sector);
+    *extent = (PageExtent){.sector = sector, .length = (uint16_t)length, .flags = flags};
+    store->dirty = true;
+    return 0;
+}
+
+int page_store_read(PageStore* store, uint64_t page_id, void* data) {
+    if (open_store(store) != 0) return -1;
+
+    const PageExtent* extent = extent_of(store, page_id, false);
+    if (!extent || extent->length == 0) return -1;
+
+    off_t offset = (off_t)(extent->sector * PAGE_STORE_SECTOR);
+    if (!(extent->flags & PAGE_EXTENT_COMPRESSED)) {
+        return pread(store->fd, data, store->page_size, offset) == (ssize_t)store->page_size ? 0 : -1;
+    }
+    if (pread(store->fd, store->buffer, extent->length, offset) != (ssize_t)extent->length) return -1;
+    return page_codec_decompress(store->buffer, extent->length, data, store->page_size);
+}
+
+int page_store_free(PageStore* store, uint64_t page_id) {
+    if (open_store(store) != 0) return -1;
+
+    PageExtent* extent = extent_of(store, page_id, false);
+    if (!extent || extent->length == 0) return -1;
+    if (list_push(&store->released[sectors_for(extent->length)], extent->sector) != 0) return -1;
+
+    extent->length = 0;
+    store->dirty = true;
+    return 0;
+}
+
+static int save_map(PageStore* store) {
+    size_t len = strlen(store->map_path);
+    char* tmp = malloc(len + sizeof(".tmp"));
+    if (!tmp) return -1;
+    memcpy(tmp, store->map_path, len);
+    memcpy(tmp + len, ".tmp", sizeof(".tmp"));
+
+    // Written aside and renamed over the old map once durable
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(tmp);
+        return -1;
+    }
+
+    // Chunks without a page are left out
+    uint64_t* saved = malloc((store->num_chunks + 1) * sizeof(uint64_t));
+    size_t num_chunks = 0;
+    for (size_t i = 0; saved && i < store->num_chunks; i++) {
+        const PageExtent* extents = store->chunks[i];
+        size_t j = 0;
+        while (extents && j < PAGE_STORE_CHUNK && extents[j].length == 0) j++;
+        if (extents && j < PAGE_STORE_CHUNK) saved[num_chunks++] = i;
+    }
+
+    // Released extents are free as of this map
+    MapHeader header = {
+        .magic = MAP_MAGIC,
+        .version = MAP_VERSION,
+        .page_size = store->page_size,
+        .end_sector = store->end_sector,
+        .num_chunks = num_chunks,
+    };
+    for (size_t i = 1; i <= PAGE_STORE_MAX_SECTORS; i++) {
+        header.num_free += store->free[i].count + store->released[i].count;
+    }
+
+    uint64_t* free_entries = header.num_free ? malloc(header.num_free * sizeof(uint64_t)) : NULL;
+    size_t n = 0;
+    for (size_t i = 1; free_entries && i <= PAGE_STORE_MAX_SECTORS; i++) {
+        for (size_t j = 0; j < store->free[i].count; j++) {
+            free_entries[n++] = store->free[i].sectors[j] << FREE_SHIFT | i;
+        }
+        for (size_t j = 0; j < store->released[i].count; j++) {
+            free_entries[n++] = store->released[i].sectors[j] << FREE_SHIFT | i;
+        }
+    }
+
+    int rc = !saved || (header.num_free && !free_entries) ? -1 : 0;
+    if (rc == 0) rc = write_all(fd, &header, sizeof(header));
+    for (size_t i = 0; rc == 0 && i < num_chunks; i++) {
+        rc = write_all(fd, &saved[i], sizeof(uint64_t));
+        if (rc == 0) rc = write_all(fd, store->chunks[saved[i]], CHUNK_BYTES);
+    }
+    if (rc == 0 && n > 0) rc = write_all(fd, free_entries, n * sizeof(uint64_t));
+    free(free_entries);
+    free(saved);
+    if (rc == 0) rc = fsync(fd);
+    if (close(fd) != 0) rc = -1;
+    if (rc == 0) rc = rename(tmp, store->map_path);
+    if (rc != 0) unlink(tmp);
+    free(tmp);
+
+    // The rename itself is only durable once the directory is synced
+    if (rc == 0) {
+        int dir = open(store->directory, O_RDONLY | O_DIRECTORY);
+        rc = dir < 0 ? -1 : fsync(dir);
+        if (dir >= 0) close(dir);
+    }
+    return rc == 0 ? 0 : -1;
+}
+
+int page_store_checkpoint(PageStore* store) {
+    if (store->fd < 0 || !store->dirty) return 0;
+    if (fdatasync(store->fd) != 0 || save_map(store) != 0) return -1;
+
+    // Nothing durable names the released extents any more, now the new
+    // map and its directory entry are synced. A failed push only leaks the
+    // space.
+    for (size_t i = 1; i <= PAGE_STORE_MAX_SECTORS; i++) {
+        ExtentList* released = &store->released[i];
+        for (size_t j = 0; j < released->count; j++) {
+            if (list_push(&store->free[i], released->sectors[j]) != 0) break;
+        }
+        released->count = 0;
+    }
+    store->dirty = false;
+    return 0;
+}
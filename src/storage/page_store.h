@@ -0,0 +1,75 @@
+#ifndef OBELISK_PAGE_STORE_H
+#define OBELISK_PAGE_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <obelisk/storage.h>
+
+// Pages addressed by id alone, behind storage_write_page and friends. They
+// live in one file of 512-byte sectors: each write goes to a fresh extent
+// of as many sectors as the page's stored form needs, compressed when
+// compression is on and it saves a sector, raw otherwise. Extents are
+// reused only by pages needing the same number of sectors, so the file
+// never needs compacting.
+//
+// The map from page id to extent is kept in memory, in chunks of
+// PAGE_STORE_CHUNK ids allocated as ids in them are first written, and
+// saved to a separate file at checkpoints. An extent a page gave up is reused only
+// once a checkpoint has saved a map that no longer names it, so after a
+// crash the store reads back as it was at the last checkpoint.
+
+#define PAGE_STORE_SECTOR 512
+#define PAGE_STORE_MAX_SECTORS 32    // A 16 KiB page stored raw
+
+#define PAGE_STORE_CHUNK 4096
+#define PAGE_STORE_MAX_CHUNKS (OBELISK_STORAGE_MAX_PAGES / PAGE_STORE_CHUNK)
+
+#define PAGE_EXTENT_COMPRESSED 0x1
+
+typedef struct {
+    uint64_t sector;            // First sector in the file
+    uint16_t length;            // Stored bytes, 0 for a page that is not there
+    uint16_t flags;             // PAGE_EXTENT_*
+    uint32_t reserved;
+} PageExtent;
+
+// First sectors of extents of one length
+typedef struct {
+    uint64_t* sectors;
+    size_t count;
+    size_t capacity;
+} ExtentList;
+
+typedef struct {
+    char* directory;            // Synced once a new map is renamed into it
+    char* data_path;
+    char* map_path;
+    int fd;                     // -1 until the first page operation
+    size_t page_size;
+    bool compress;
+
+    PageExtent** chunks;        // By page id / PAGE_STORE_CHUNK; NULL where none was written
+    size_t num_chunks;
+    uint64_t end_sector;        // Sectors ever handed out
+    bool dirty;                 // Changed since the map was saved
+
+    // By sector count; released extents are named by the saved map until
+    // the next checkpoint replaces it
+    ExtentList free[PAGE_STORE_MAX_SECTORS + 1];
+    ExtentList released[PAGE_STORE_MAX_SECTORS + 1];
+
+    char* buffer;               // A page's stored form
+} PageStore;
+
+int page_store_init(PageStore* store, const char* directory, size_t page_size, bool compress);
+void page_store_destroy(PageStore* store);
+
+int page_store_write(PageStore* store, uint64_t page_id, const void* data);
+int page_store_read(PageStore* store, uint64_t page_id, void* data);  // -1 for a page not there
+int page_store_free(PageStore* store, uint64_t page_id);
+
+// Make every page written so far durable, then save the map
+int page_store_checkpoint(PageStore* store);
+
+#endif // OBELISK_PAGE_STORE_H
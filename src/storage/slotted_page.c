@@ -0,0 +1,154 @@
+#include <string.h>
+#include "slotted_page.h"
+
+static SlotEntry* slots_of(void* page) {
+    return (SlotEntry*)((char*)page + sizeof(SlottedPageHeader));
+}
+
+static const SlotEntry* const_slots_of(const void* page) {
+    return (const SlotEntry*)((const char*)page + sizeof(SlottedPageHeader));
+}
+
+// Contiguous bytes between the slot directory and the records
+static size_t gap_of(const SlottedPageHeader* header) {
+    size_t directory_end = sizeof(SlottedPageHeader) + header->num_slots * sizeof(SlotEntry);
+    return header->data_start - directory_end;
+}
+
+static int find_free_slot(const void* page) {
+    const SlottedPageHeader* header = page;
+    const SlotEntry* slots = const_slots_of(page);
+    for (uint16_t i = 0; i < header->num_slots; i++) {
+        if (slots[i].offset == 0) return i;
+    }
+    return -1;
+}
+
+void slotted_page_init(void* page, size_t page_size, uint64_t page_id) {
+    memset(page, 0, page_size);
+    SlottedPageHeader* header = page;
+    header->header.page_id = page_id;
+    header->header.free_space = (uint32_t)(page_size - sizeof(SlottedPageHeader));
+    header->header.flags = SLOTTED_PAGE_FLAG_HEAP;
+    header->data_start = (uint16_t)page_size;
+}
+
+size_t slotted_page_max_record(size_t page_size) {
+    size_t max = page_size - sizeof(SlottedPageHeader) - sizeof(SlotEntry);
+    return max < SLOTTED_LENGTH_MASK ? max : SLOTTED_LENGTH_MASK;
+}
+
+bool slotted_page_fits(const void* page, size_t len) {
+    const SlottedPageHeader* header = page;
+    if (len > SLOTTED_LENGTH_MASK) return false;
+    size_t need = len + (find_free_slot(page) < 0 ? sizeof(SlotEntry) : 0);
+    return header->header.free_space >= need;
+}
+
+// Put len bytes at the bottom of the record area for slot, compacting first
+// if the gap is too small. The caller has checked free_space.
+static void place_record(void* page, size_t page_size, uint16_t slot, const void* data, size_t len,
+                         uint16_t flags) {
+    SlottedPageHeader* header = page;
+    if (gap_of(header) < len) slotted_page_compact(page, page_size);
+
+    header->data_start -= (uint16_t)len;
+    memcpy((char*)page + header->data_start, data, len);
+    SlotEntry* entry = &slots_of(page)[slot];
+    entry->offset = header->data_start;
+    entry->length = (uint16_t)(len | flags);
+    header->header.free_space -= (uint32_t)len;
+}
+
+int slotted_page_insert(void* page, size_t page_size, const void* data, size_t len, uint16_t flags) {
+    SlottedPageHeader* header = page;
+    if (!slotted_page_fits(page, len)) return -1;
+
+    // A new directory entry takes its bytes from the gap, so make room for
+    // it and the record together
+    int slot = find_free_slot(page);
+    if (slot < 0) {
+        if (gap_of(header) < len + sizeof(SlotEntry)) slotted_page_compact(page, page_size);
+        slot = header->num_slots++;
+        slots_of(page)[slot] = (SlotEntry){0, 0};
+        header->header.free_space -= sizeof(SlotEntry);
+    }
+
+    place_record(page, page_size, (uint16_t)slot, data, len, flags);
+    header->header.num_records++;
+    return slot;
+}
+
+const void* slotted_page_get(const void* page, uint16_t slot, size_t* len, uint16_t* flags) {
+    const SlottedPageHeader* header = page;
+    if (slot >= header->num_slots) return NULL;
+
+    const SlotEntry* entry = &const_slots_of(page)[slot];
+    if (entry->offset == 0) return NULL;
+
+    if (len) *len = entry->length & SLOTTED_LENGTH_MASK;
+    if (flags) *flags = entry->length & ~SLOTTED_LENGTH_MASK;
+    return (const char*)page + entry->offset;
+}
+
+int slotted_page_update(void* page, size_t page_size, uint16_t slot, const void* data, size_t len,
+                        uint16_t flags) {
+    SlottedPageHeader* header = page;
+    if (slot >= header->num_slots || len > SLOTTED_LENGTH_MASK) return -1;
+
+    SlotEntry* entry = &slots_of(page)[slot];
+    if (entry->offset == 0) return -1;
+
+    // Shrinking or same-size records are rewritten where they are
+    size_t old = entry->length & SLOTTED_LENGTH_MASK;
+    if (len <= old) {
+        memcpy((char*)page + entry->offset, data, len);
+        entry->length = (uint16_t)(len | flags);
+        header->header.free_space += (uint32_t)(old - len);
+        return 0;
+    }
+
+    // A growing record gives its old bytes up and is placed afresh
+    if (header->header.free_space + old < len) return -1;
+    entry->offset = 0;
+    header->header.free_space += (uint32_t)old;
+    place_record(page, page_size, slot, data, len, flags);
+    return 0;
+}
+
+int slotted_page_delete(void* page, uint16_t slot) {
+    SlottedPageHeader* header = page;
+    if (slot >= header->num_slots) return -1;
+
+    SlotEntry* slots = slots_of(page);
+    if (slots[slot].offset == 0) return -1;
+
+    header->header.free_space += slots[slot].length & SLOTTED_LENGTH_MASK;
+    slots[slot] = (SlotEntry){0, 0};
+    header->header.num_records--;
+
+    // Free entries at the end of the directory are given back
+    while (header->num_slots > 0 && slots[header->num_slots - 1].offset == 0) {
+        header->num_slots--;
+        header->header.free_space += sizeof(SlotEntry);
+    }
+    return 0;
+}
+
+void slotted_page_compact(void* page, size_t page_size) {
+    SlottedPageHeader* header = page;
+    SlotEntry* slots = slots_of(page);
+    char scratch[SLOTTED_PAGE_MAX_SIZE];
+
+    size_t end = page_size;
+    for (uint16_t i = 0; i < header->num_slots; i++) {
+        if (slots[i].offset == 0) continue;
+        size_t len = slots[i].length & SLOTTED_LENGTH_MASK;
+        end -= len;
+        memcpy(scratch + end, (char*)page + slots[i].offset, len);
+        slots[i].offset = (uint16_t)end;
+    }
+
+    memcpy((char*)page + end, scratch + end, page_size - end);
+    header->data_start = (uint16_t)end;
+}
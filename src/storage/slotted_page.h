@@ -0,0 +1,65 @@
+#ifndef OBELISK_SLOTTED_PAGE_H
+#define OBELISK_SLOTTED_PAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <obelisk/storage.h>
+
+// Heap page layout. The ObeliskPageHeader comes first, followed by a slot
+// directory that grows towards the end of the page; record bytes are packed
+// from the end of the page downwards. A record keeps its slot for life, so
+// (page, slot) names it while the bytes move about during compaction.
+//
+// header.num_records counts the slots in use and header.free_space every
+// byte that compaction could gather: the gap between the directory and the
+// records plus the holes left by deleted and shrunk records.
+
+#define SLOTTED_PAGE_MIN_SIZE 512
+#define SLOTTED_PAGE_MAX_SIZE 16384
+
+// Slot flags, kept in the top bits of the slot length
+#define SLOTTED_FORWARD 0x8000  // Holds the record id the record moved to
+#define SLOTTED_MOVED 0x4000    // Moved here from a forwarding slot
+#define SLOTTED_LENGTH_MASK 0x3FFF
+
+#define SLOTTED_PAGE_FLAG_HEAP 0x01  // header.flags of an initialized heap page
+
+typedef struct {
+    ObeliskPageHeader header;
+    uint16_t num_slots;       // Directory entries, live or free
+    uint16_t data_start;      // Lowest offset holding record bytes
+} SlottedPageHeader;
+
+typedef struct {
+    uint16_t offset;          // 0 for a free slot
+    uint16_t length;          // Record bytes, with the SLOTTED_* flags on top
+} SlotEntry;
+
+void slotted_page_init(void* page, size_t page_size, uint64_t page_id);
+
+// Largest record that fits on an empty page
+size_t slotted_page_max_record(size_t page_size);
+
+// Whether a record of len bytes fits, reusing a free slot if there is one
+bool slotted_page_fits(const void* page, size_t len);
+
+// Store a record and return its slot, or -1 if it does not fit. Compacts
+// the page first if the free bytes are there but scattered.
+int slotted_page_insert(void* page, size_t page_size, const void* data, size_t len, uint16_t flags);
+
+// A record's bytes, length and flags, or NULL for a free or unknown slot.
+// The pointer is good until the page is next changed.
+const void* slotted_page_get(const void* page, uint16_t slot, size_t* len, uint16_t* flags);
+
+// Replace a record's bytes and flags, in place when it does not grow.
+// Returns -1, leaving the record alone, if the page has no room for it.
+int slotted_page_update(void* page, size_t page_size, uint16_t slot, const void* data, size_t len,
+                        uint16_t flags);
+
+int slotted_page_delete(void* page, uint16_t slot);
+
+// Pack the records against the end of the page, closing every hole
+void slotted_page_compact(void* page, size_t page_size);
+
+#endif // OBELISK_SLOTTED_PAGE_H
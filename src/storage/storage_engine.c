@@ -6,6 +6,9 @@
 #include <unistd.h>
 #include <obelisk/storage.h>
 #include <obelisk/db.h>
+#include "slotted_page.h"
+#include "catalog.h"
+#include "page_store.h"
 
 // Internal storage structure
 struct ObeliskStorage {
@@ -15,9 +18,11 @@ struct ObeliskStorage {
     bool enable_encryption;
     char* encryption_key;
     
-    // File descriptors for data files
-    int* table_fds;
-    size_t num_tables;
+    // Open tables by name
+    Catalog catalog;
+
+    // Pages addressed by id alone, compressed when enabled
+    PageStore pages;
     
     // Statistics
     ObeliskStorageStats stats;
@@ -26,17 +31,27 @@ struct ObeliskStorage {
 ObeliskStorage* storage_create(const ObeliskStorageConfig* config) {
     if (!config || !config->data_directory) return NULL;
 
-    ObeliskStorage* storage = malloc(sizeof(ObeliskStorage));
+    // Slot offsets are 16-bit, which caps the heap page size
+    size_t page_size = config->page_size ? config->page_size : OBELISK_PAGE_SIZE;
+    if (page_size < SLOTTED_PAGE_MIN_SIZE || page_size > SLOTTED_PAGE_MAX_SIZE) return NULL;
+
+    ObeliskStorage* storage = calloc(1, sizeof(ObeliskStorage));
     if (!storage) return NULL;
 
     storage->data_directory = strdup(config->data_directory);
-    storage->page_size = config->page_size;
+    storage->page_size = page_size;
     storage->enable_compression = config->enable_compression;
     storage->enable_encryption = config->enable_encryption;
     storage->encryption_key = config->encryption_key ? strdup(config->encryption_key) : NULL;
 
-    storage->table_fds = NULL;
-    storage->num_tables = 0;
+    if (!storage->data_directory || catalog_init(&storage->catalog) != 0 ||
+        page_store_init(&storage->pages, storage->data_directory, page_size, config->enable_compression) != 0) {
+        if (storage->catalog.buckets) catalog_destroy(&storage->catalog);
+        free(storage->data_directory);
+        free(storage->encryption_key);
+        free(storage);
+        return NULL;
+    }
 
     // Create data directory if it doesn't exist
     mkdir(storage->data_directory, 0755);
@@ -47,17 +62,22 @@ ObeliskStorage* storage_create(const ObeliskStorageConfig* config) {
     return storage;
 }
 
+static int close_file(CatalogTable* table, void* ctx) {
+    (void)ctx;
+    if (table->fd >= 0) close(table->fd);
+    table->fd = -1;
+    return 0;
+}
+
 void storage_destroy(ObeliskStorage* storage) {
     if (!storage) return;
 
-    // Close all open files
-    for (size_t i = 0; i < storage->num_tables; i++) {
-        if (storage->table_fds[i] > 0) {
-            close(storage->table_fds[i]);
-        }
-    }
+    // Metadata reaches the files before they are closed
+    storage_checkpoint(storage);
+    catalog_for_each(&storage->catalog, close_file, NULL);
+    catalog_destroy(&storage->catalog);
+    page_store_destroy(&storage->pages);
 
-    free(storage->table_fds);
     free(storage->data_directory);
     free(storage->encryption_key);
     free(storage);
@@ -72,64 +92,254 @@ static char* get_table_path(ObeliskStorage* storage, const char* table_name) {
     return path;
 }
 
+// Records are stored as their timestamp followed by their data; a slot
+// whose record moved holds the record id it moved to instead
+#define RECORD_PREFIX sizeof(uint64_t)
+
+static int write_meta(CatalogTable* table) {
+    ssize_t written = pwrite(table->fd, &table->meta, sizeof(TableMeta), 0);
+    return written == sizeof(TableMeta) ? 0 : -1;
+}
+
+// The first change after a checkpoint takes the clean mark off the file's
+// metadata, so a crash before the next checkpoint is noticed on open
+static int dirty_meta(CatalogTable* table) {
+    if (table->meta_dirty) return 0;
+    table->meta.flags &= ~(uint64_t)TABLE_META_CLEAN;
+    if (write_meta(table) != 0) return -1;
+    table->meta_dirty = true;
+    return 0;
+}
+
+// FNV-1a over the page with its checksum field taken as zero
+static uint32_t page_checksum(void* page, size_t page_size) {
+    ObeliskPageHeader* header = page;
+    uint32_t saved = header->checksum;
+    header->checksum = 0;
+
+    uint32_t hash = 2166136261u;
+    const unsigned char* bytes = page;
+    for (size_t i = 0; i < page_size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    header->checksum = saved;
+    return hash;
+}
+
+static int read_page_from_file(ObeliskStorage* storage, int fd, uint64_t page_id, void* page) {
+    off_t offset = (off_t)(page_id * storage->page_size);
+    if (pread(fd, page, storage->page_size, offset) != (ssize_t)storage->page_size) return -1;
+
+    // A torn or damaged page is refused rather than misread
+    ObeliskPageHeader* header = page;
+    if (header->page_id != page_id || header->checksum != page_checksum(page, storage->page_size)) return -1;
+    return 0;
+}
+
+// The last page comes from memory; the others from the file
+static int read_heap_page(ObeliskStorage* storage, CatalogTable* table, uint64_t page_id, void* page) {
+    if (page_id == 0 || page_id > table->meta.last_page) return -1;
+    if (page_id == table->meta.last_page) {
+        if (page != table->tail) memcpy(page, table->tail, storage->page_size);
+        return 0;
+    }
+    return read_page_from_file(storage, table->fd, page_id, page);
+}
+
+static int write_heap_page(ObeliskStorage* storage, CatalogTable* table, void* page) {
+    ObeliskPageHeader* header = page;
+    header->checksum = page_checksum(page, storage->page_size);
+
+    off_t offset = (off_t)(header->page_id * storage->page_size);
+    ssize_t written = pwrite(table->fd, page, storage->page_size, offset);
+    if (written != (ssize_t)storage->page_size) return -1;
+
+    if (header->page_id == table->meta.last_page && page != table->tail) {
+        memcpy(table->tail, page, storage->page_size);
+    }
+    return 0;
+}
+
+// Store a record body on the table's last page, or on a new page chained
+// after it when it does not fit, and report where it went. The change is
+// made on a copy in table->page, so the cached tail and the table's bounds
+// only move once the page is written.
+static int append_body(ObeliskStorage* storage, CatalogTable* table, const void* body, size_t len,
+                       uint16_t flags, uint64_t* record_id) {
+    char* page = table->page;
+    uint64_t last = table->meta.last_page;
+    if (last != 0 && slotted_page_fits(table->tail, len)) {
+        memcpy(page, table->tail, storage->page_size);
+        int slot = slotted_page_insert(page, storage->page_size, body, len, flags);
+        if (write_heap_page(storage, table, page) != 0) return -1;
+        *record_id = OBELISK_RECORD_ID(last, slot);
+        return 0;
+    }
+
+    // Chain a new page after the full one. The table's bounds change, so
+    // the next checkpoint has to write its metadata.
+    uint64_t page_id = last + 1;
+    if (page_id > OBELISK_RECORD_PAGE(UINT64_MAX)) return -1;
+    if (dirty_meta(table) != 0) return -1;
+    if (last != 0) {
+        memcpy(page, table->tail, storage->page_size);
+        ((ObeliskPageHeader*)page)->next_page = page_id;
+        if (write_heap_page(storage, table, page) != 0) return -1;
+    }
+
+    slotted_page_init(page, storage->page_size, page_id);
+    ((ObeliskPageHeader*)page)->prev_page = last;
+    int slot = slotted_page_insert(page, storage->page_size, body, len, flags);
+    if (write_heap_page(storage, table, page) != 0) return -1;
+    memcpy(table->tail, page, storage->page_size);
+    table->meta.last_page = page_id;
+    if (table->meta.first_page == 0) table->meta.first_page = page_id;
+    storage->stats.total_pages++;
+
+    *record_id = OBELISK_RECORD_ID(page_id, slot);
+    return 0;
+}
+
+// Lay a record out in body as it is stored on a page; returns its length
+static size_t encode_record(const ObeliskRecord* record, char* body) {
+    memcpy(body, &record->timestamp, RECORD_PREFIX);
+    if (record->size > 0) memcpy(body + RECORD_PREFIX, record->data, record->size);
+    return RECORD_PREFIX + record->size;
+}
+
+// A table changed since its last checkpoint may have pages its metadata
+// does not know of and a stale record count; both are rebuilt from the
+// heap pages themselves. Pages past the checkpointed last page may have
+// been torn by the crash, so the file is cut off at the first bad one; a
+// bad page the checkpoint covered fails the table.
+static int recover_table(ObeliskStorage* storage, CatalogTable* table) {
+    struct stat st;
+    if (fstat(table->fd, &st) != 0) return -1;
+
+    uint64_t checkpointed = table->meta.last_page;
+    uint64_t pages = (uint64_t)st.st_size / storage->page_size;
+    table->meta.last_page = pages > 1 ? pages - 1 : 0;
+    table->meta.num_records = 0;
+
+    // Moved records are counted at their home slot
+    for (uint64_t page_id = 1; page_id <= table->meta.last_page; page_id++) {
+        if (read_page_from_file(storage, table->fd, page_id, table->page) != 0) {
+            if (page_id <= checkpointed) return -1;
+            table->meta.last_page = page_id - 1;
+            break;
+        }
+        const SlottedPageHeader* header = (const SlottedPageHeader*)table->page;
+        for (uint16_t slot = 0; slot < header->num_slots; slot++) {
+            uint16_t flags;
+            if (slotted_page_get(table->page, slot, NULL, &flags) && !(flags & SLOTTED_MOVED)) {
+                table->meta.num_records++;
+            }
+        }
+    }
+
+    // Drop the torn pages, and any partial page a crash left at the end
+    off_t length = (off_t)((table->meta.last_page + 1) * storage->page_size);
+    if (length < st.st_size && ftruncate(table->fd, length) != 0) return -1;
+    table->meta.first_page = table->meta.last_page ? 1 : 0;
+
+    table->meta_dirty = true;
+    return 0;
+}
+
+static void close_table(ObeliskStorage* storage, CatalogTable* table) {
+    if (table->fd >= 0) close(table->fd);
+    catalog_remove(&storage->catalog, table);
+}
+
+// The catalog entry for a table, opening the table on first use
+static CatalogTable* open_table(ObeliskStorage* storage, const char* table_name) {
+    CatalogTable* table = catalog_find(&storage->catalog, table_name);
+    if (table) return table;
+
+    char* table_path = get_table_path(storage, table_name);
+    if (!table_path) return NULL;
+    int fd = open(table_path, O_RDWR);
+    free(table_path);
+    if (fd < 0) return NULL;
+
+    table = catalog_add(&storage->catalog, table_name, storage->page_size);
+    if (!table) {
+        close(fd);
+        return NULL;
+    }
+    table->fd = fd;
+
+    TableMeta* meta = &table->meta;
+    bool ok = pread(fd, meta, sizeof(TableMeta), 0) == sizeof(TableMeta) && meta->magic == TABLE_META_MAGIC;
+    if (ok && !(meta->flags & TABLE_META_CLEAN)) ok = recover_table(storage, table) == 0;
+    if (ok && meta->last_page != 0) ok = read_page_from_file(storage, fd, meta->last_page, table->tail) == 0;
+    if (!ok) {
+        close_table(storage, table);
+        return NULL;
+    }
+    return table;
+}
+
 int storage_create_table(ObeliskStorage* storage, const char* table_name, 
-                        const struct ObeliskColumn* columns, size_t num_columns) {
+                        const ObeliskColumn* columns, size_t num_columns) {
     if (!storage || !table_name || !columns) return -1;
 
     char* table_path = get_table_path(storage, table_name);
     if (!table_path) return -1;
 
     // Create table file
-    int fd = open(table_path, O_CREAT | O_RDWR, 0644);
+    int fd = open(table_path, O_CREAT | O_EXCL | O_RDWR, 0644);
     if (fd < 0) {
         free(table_path);
         return -1;
     }
 
     // Write table metadata
-    ObeliskTableInfo info = {
-        .table_name = (char*)table_name,
-        .num_columns = num_columns,
+    TableMeta meta = {
+        .magic = TABLE_META_MAGIC,
+        .num_columns = (uint32_t)num_columns,
         .record_size = 0,  // Calculate based on columns
         .num_records = 0,
-        .first_page = 1,
-        .last_page = 1
+        .first_page = 0,
+        .last_page = 0,
+        .flags = TABLE_META_CLEAN
     };
 
-    // Calculate record size
+    // Variable-length values are stored at their actual length, so only
+    // fixed-width columns count towards the record size
     for (size_t i = 0; i < num_columns; i++) {
         switch (columns[i].type) {
             case OBELISK_TYPE_INT:
-                info.record_size += sizeof(int);
+                meta.record_size += sizeof(int);
                 break;
             case OBELISK_TYPE_FLOAT:
-                info.record_size += sizeof(double);
-                break;
-            case OBELISK_TYPE_TEXT:
-                info.record_size += 256;  // Fixed size for simplicity
-                break;
-            case OBELISK_TYPE_BLOB:
-                info.record_size += 1024;  // Fixed size for simplicity
+                meta.record_size += sizeof(double);
                 break;
             default:
                 break;
         }
     }
 
-    // Write table info
-    write(fd, &info, sizeof(ObeliskTableInfo));
+    // An entry left from a table removed behind our back is stale
+    CatalogTable* stale = catalog_find(&storage->catalog, table_name);
+    if (stale) close_table(storage, stale);
 
-    // Add file descriptor to storage
-    int* new_fds = realloc(storage->table_fds, (storage->num_tables + 1) * sizeof(int));
-    if (!new_fds) {
+    // The metadata takes a whole page so heap pages stay page aligned
+    CatalogTable* table = catalog_add(&storage->catalog, table_name, storage->page_size);
+    if (table) {
+        memset(table->page, 0, storage->page_size);
+        memcpy(table->page, &meta, sizeof(TableMeta));
+    }
+    if (!table || pwrite(fd, table->page, storage->page_size, 0) != (ssize_t)storage->page_size) {
+        if (table) catalog_remove(&storage->catalog, table);
         close(fd);
+        unlink(table_path);
         free(table_path);
         return -1;
     }
 
-    storage->table_fds = new_fds;
-    storage->table_fds[storage->num_tables++] = fd;
-
+    table->fd = fd;
+    table->meta = meta;
     free(table_path);
     return 0;
 }
@@ -140,110 +350,352 @@ int storage_drop_table(ObeliskStorage* storage, const char* table_name) {
     char* table_path = get_table_path(storage, table_name);
     if (!table_path) return -1;
 
-    // Close file descriptor if open
-    for (size_t i = 0; i < storage->num_tables; i++) {
-        if (storage->table_fds[i] > 0) {
-            close(storage->table_fds[i]);
-            storage->table_fds[i] = -1;
-        }
-    }
+    // Only this table's file is closed
+    CatalogTable* table = catalog_find(&storage->catalog, table_name);
+    if (table) close_table(storage, table);
 
     // Delete file
-    unlink(table_path);
+    int rc = unlink(table_path);
     free(table_path);
 
-    return 0;
+    return rc == 0 ? 0 : -1;
 }
 
 ObeliskTableInfo* storage_get_table_info(ObeliskStorage* storage, const char* table_name) {
     if (!storage || !table_name) return NULL;
 
-    char* table_path = get_table_path(storage, table_name);
-    if (!table_path) return NULL;
+    CatalogTable* table = open_table(storage, table_name);
+    if (!table) return NULL;
+
+    // The name lives in the same allocation, so free() releases both
+    size_t name_len = strlen(table_name) + 1;
+    ObeliskTableInfo* info = malloc(sizeof(ObeliskTableInfo) + name_len);
+    if (!info) return NULL;
+
+    info->table_name = (char*)(info + 1);
+    memcpy(info->table_name, table_name, name_len);
+    info->num_columns = table->meta.num_columns;
+    info->record_size = table->meta.record_size;
+    info->num_records = table->meta.num_records;
+    info->first_page = table->meta.first_page;
+    info->last_page = table->meta.last_page;
+    return info;
+}
 
-    int fd = open(table_path, O_RDONLY);
-    if (fd < 0) {
-        free(table_path);
-        return NULL;
+int storage_insert_record(ObeliskStorage* storage, const char* table_name, const ObeliskRecord* record,
+                          uint64_t* record_id) {
+    if (!storage || !table_name || !record || (record->size > 0 && !record->data)) return -1;
+
+    // Records larger than a page have nowhere to go
+    if (RECORD_PREFIX + record->size > slotted_page_max_record(storage->page_size)) return -1;
+
+    CatalogTable* table = open_table(storage, table_name);
+    if (!table || dirty_meta(table) != 0) return -1;
+
+    uint64_t id;
+    size_t len = encode_record(record, table->body);
+    if (append_body(storage, table, table->body, len, 0, &id) != 0) return -1;
+    table->meta.num_records++;
+
+    if (record_id) *record_id = id;
+    storage->stats.total_records++;
+    return 0;
+}
+
+// Read the home page of record_id into page and find where the record's
+// bytes are: on that page, or on the page its forwarding slot points to
+static int locate_record(ObeliskStorage* storage, CatalogTable* table, uint64_t record_id, char* page,
+                         uint64_t* location) {
+    uint16_t flags;
+    size_t len;
+    if (read_heap_page(storage, table, OBELISK_RECORD_PAGE(record_id), page) != 0) return -1;
+    const void* bytes = slotted_page_get(page, OBELISK_RECORD_SLOT(record_id), &len, &flags);
+
+    // Only the home slot names a record
+    if (!bytes || (flags & SLOTTED_MOVED)) return -1;
+    if (flags & SLOTTED_FORWARD) {
+        memcpy(location, bytes, sizeof(uint64_t));
+    } else {
+        *location = record_id;
     }
+    return 0;
+}
 
-    ObeliskTableInfo* info = malloc(sizeof(ObeliskTableInfo));
-    if (!info) {
-        close(fd);
-        free(table_path);
-        return NULL;
+int storage_update_record(ObeliskStorage* storage, const char* table_name, 
+                         uint64_t record_id, const ObeliskRecord* record) {
+    if (!storage || !table_name || !record || (record->size > 0 && !record->data)) return -1;
+    if (RECORD_PREFIX + record->size > slotted_page_max_record(storage->page_size)) return -1;
+
+    CatalogTable* table = open_table(storage, table_name);
+    if (!table) return -1;
+
+    char* page = table->page;
+    size_t len = encode_record(record, table->body);
+    uint64_t location;
+    int rc = locate_record(storage, table, record_id, page, &location);
+    if (rc == 0) rc = dirty_meta(table);
+    bool moved = rc == 0 && location != record_id;
+    uint16_t flags = moved ? SLOTTED_MOVED : 0;
+
+    // In place whenever the page holding the record has room for it
+    if (rc == 0 && moved) rc = read_heap_page(storage, table, OBELISK_RECORD_PAGE(location), page);
+    if (rc == 0 && slotted_page_update(page, storage->page_size, OBELISK_RECORD_SLOT(location),
+                                       table->body, len, flags) == 0) {
+        return write_heap_page(storage, table, page);
+    }
+    if (rc != 0) return -1;
+
+    // Otherwise the record moves and its home slot forwards to it. Pages
+    // are reread between steps, since any of them may be the last page.
+    uint64_t target;
+    rc = append_body(storage, table, table->body, len, SLOTTED_MOVED, &target);
+    if (rc == 0) rc = read_heap_page(storage, table, OBELISK_RECORD_PAGE(record_id), page);
+    if (rc == 0) {
+        slotted_page_update(page, storage->page_size, OBELISK_RECORD_SLOT(record_id),
+                            &target, sizeof(target), SLOTTED_FORWARD);
+        rc = write_heap_page(storage, table, page);
     }
 
-    // Read table info
-    ssize_t bytes_read = read(fd, info, sizeof(ObeliskTableInfo));
-    if (bytes_read != sizeof(ObeliskTableInfo)) {
-        free(info);
-        close(fd);
-        free(table_path);
-        return NULL;
+    // Chains never grow past one hop: the old copy goes
+    if (rc == 0 && moved) rc = read_heap_page(storage, table, OBELISK_RECORD_PAGE(location), page);
+    if (rc == 0 && moved) {
+        slotted_page_delete(page, OBELISK_RECORD_SLOT(location));
+        rc = write_heap_page(storage, table, page);
     }
+    return rc;
+}
 
-    close(fd);
-    free(table_path);
-    return info;
+int storage_delete_record(ObeliskStorage* storage, const char* table_name, uint64_t record_id) {
+    if (!storage || !table_name) return -1;
+
+    CatalogTable* table = open_table(storage, table_name);
+    if (!table) return -1;
+
+    char* page = table->page;
+    uint64_t location;
+    int rc = locate_record(storage, table, record_id, page, &location);
+    if (rc == 0) rc = dirty_meta(table);
+
+    // A moved record's bytes go first, then its home slot
+    if (rc == 0 && location != record_id) {
+        rc = read_heap_page(storage, table, OBELISK_RECORD_PAGE(location), page);
+        if (rc == 0) {
+            slotted_page_delete(page, OBELISK_RECORD_SLOT(location));
+            rc = write_heap_page(storage, table, page);
+        }
+        if (rc == 0) rc = read_heap_page(storage, table, OBELISK_RECORD_PAGE(record_id), page);
+    }
+    if (rc == 0) {
+        slotted_page_delete(page, OBELISK_RECORD_SLOT(record_id));
+        rc = write_heap_page(storage, table, page);
+    }
+    if (rc != 0) return -1;
+
+    table->meta.num_records--;
+    if (storage->stats.total_records > 0) storage->stats.total_records--;
+    storage->stats.deleted_records++;
+    return 0;
 }
 
-int storage_insert_record(ObeliskStorage* storage, const char* table_name, const ObeliskRecord* record) {
-    if (!storage || !table_name || !record) return -1;
+ObeliskRecord* storage_get_record(ObeliskStorage* storage, const char* table_name, uint64_t record_id) {
+    if (!storage || !table_name) return NULL;
 
-    ObeliskTableInfo* info = storage_get_table_info(storage, table_name);
-    if (!info) return -1;
+    CatalogTable* table = open_table(storage, table_name);
+    if (!table) return NULL;
 
-    char* table_path = get_table_path(storage, table_name);
-    if (!table_path) {
-        free(info);
-        return -1;
+    char* page = table->page;
+    uint64_t location;
+    int rc = locate_record(storage, table, record_id, page, &location);
+    if (rc == 0 && location != record_id) {
+        rc = read_heap_page(storage, table, OBELISK_RECORD_PAGE(location), page);
     }
 
-    int fd = open(table_path, O_WRONLY | O_APPEND);
-    if (fd < 0) {
-        free(info);
-        free(table_path);
-        return -1;
+    size_t len = 0;
+    const char* bytes = rc == 0 ? slotted_page_get(page, OBELISK_RECORD_SLOT(location), &len, NULL) : NULL;
+    if (!bytes || len < RECORD_PREFIX) return NULL;
+
+    // The data lives in the same allocation, so free() releases both
+    size_t size = len - RECORD_PREFIX;
+    ObeliskRecord* record = malloc(sizeof(ObeliskRecord) + size);
+    if (!record) return NULL;
+
+    record->record_id = record_id;
+    record->data = record + 1;
+    record->size = size;
+    record->is_deleted = false;
+    memcpy(&record->timestamp, bytes, RECORD_PREFIX);
+    memcpy(record->data, bytes + RECORD_PREFIX, size);
+    return record;
+}
+
+// Pages a loader fills in memory before writing them out together
+#define LOADER_BATCH_PAGES 64
+
+// A run of consecutive heap pages built in memory. The first continues the
+// table's last page, so a batch is written with one pwrite and nothing on
+// disk points at a page that is not there yet.
+struct ObeliskTableLoader {
+    ObeliskStorage* storage;
+    CatalogTable* table;
+    char* pages;
+    size_t capacity;            // Pages the batch holds, at least 2
+    size_t count;               // Pages in use
+    uint64_t first_id;          // Page id of the first page
+    uint64_t records;           // Appended since the last flush
+    bool failed;                // A batch could not be written
+};
+
+static void loader_init(ObeliskTableLoader* loader, ObeliskStorage* storage, CatalogTable* table,
+                        char* pages, size_t capacity) {
+    loader->storage = storage;
+    loader->table = table;
+    loader->pages = pages;
+    loader->capacity = capacity;
+    loader->count = 0;
+    loader->first_id = table->meta.last_page ? table->meta.last_page : 1;
+    loader->records = 0;
+    loader->failed = false;
+    if (table->meta.last_page) {
+        memcpy(pages, table->tail, storage->page_size);
+        loader->count = 1;
     }
+}
 
-    // Write record
-    ssize_t bytes_written = write(fd, record, sizeof(ObeliskRecord));
-    if (bytes_written != sizeof(ObeliskRecord)) {
-        close(fd);
-        free(info);
-        free(table_path);
+// Write the batch and account for it. The last page stays behind as the
+// first of the next batch.
+static int loader_flush(ObeliskTableLoader* loader) {
+    ObeliskStorage* storage = loader->storage;
+    CatalogTable* table = loader->table;
+    size_t page_size = storage->page_size;
+    if (loader->failed) return -1;
+    if (loader->count == 0) return 0;
+
+    for (size_t i = 0; i < loader->count; i++) {
+        ObeliskPageHeader* header = (ObeliskPageHeader*)(loader->pages + i * page_size);
+        header->checksum = page_checksum(header, page_size);
+    }
+
+    size_t bytes = loader->count * page_size;
+    off_t offset = (off_t)(loader->first_id * page_size);
+    if (dirty_meta(table) != 0 || pwrite(table->fd, loader->pages, bytes, offset) != (ssize_t)bytes) {
+        loader->failed = true;
         return -1;
     }
 
-    // Update table info
-    info->num_records++;
-    lseek(fd, 0, SEEK_SET);
-    write(fd, info, sizeof(ObeliskTableInfo));
+    uint64_t last = loader->first_id + loader->count - 1;
+    char* last_page = loader->pages + (loader->count - 1) * page_size;
+    storage->stats.total_pages += last - table->meta.last_page;
+    storage->stats.total_records += loader->records;
+    table->meta.num_records += loader->records;
+    table->meta.last_page = last;
+    if (table->meta.first_page == 0) table->meta.first_page = loader->first_id;
+    memcpy(table->tail, last_page, page_size);
+
+    if (loader->count > 1) memcpy(loader->pages, last_page, page_size);
+    loader->first_id = last;
+    loader->count = 1;
+    loader->records = 0;
+    return 0;
+}
 
-    close(fd);
-    free(info);
-    free(table_path);
-    storage->stats.total_records++;
+static int loader_add(ObeliskTableLoader* loader, const ObeliskRecord* record, uint64_t* record_id) {
+    size_t page_size = loader->storage->page_size;
+    CatalogTable* table = loader->table;
+    if (loader->failed) return -1;
+
+    size_t len = encode_record(record, table->body);
+    char* page = loader->count ? loader->pages + (loader->count - 1) * page_size : NULL;
+    if (!page || !slotted_page_fits(page, len)) {
+        if (loader->count == loader->capacity) {
+            if (loader_flush(loader) != 0) return -1;
+            page = loader->pages;
+        }
 
+        // Chain a new page after the full one
+        uint64_t page_id = loader->first_id + loader->count;
+        if (page_id > OBELISK_RECORD_PAGE(UINT64_MAX)) return -1;
+        if (page) ((ObeliskPageHeader*)page)->next_page = page_id;
+
+        page = loader->pages + loader->count * page_size;
+        slotted_page_init(page, page_size, page_id);
+        ((ObeliskPageHeader*)page)->prev_page = loader->count ? page_id - 1 : 0;
+        loader->count++;
+    }
+
+    int slot = slotted_page_insert(page, page_size, table->body, len, 0);
+    loader->records++;
+    if (record_id) *record_id = OBELISK_RECORD_ID(loader->first_id + loader->count - 1, slot);
     return 0;
 }
 
-// Placeholder implementations for remaining functions
-int storage_update_record(ObeliskStorage* storage, const char* table_name, 
-                         uint64_t record_id, const ObeliskRecord* record) {
-    // TODO: Implement record update
-    return -1;
+static bool record_fits(ObeliskStorage* storage, const ObeliskRecord* record) {
+    if (record->size > 0 && !record->data) return false;
+    return RECORD_PREFIX + record->size <= slotted_page_max_record(storage->page_size);
 }
 
-int storage_delete_record(ObeliskStorage* storage, const char* table_name, uint64_t record_id) {
-    // TODO: Implement record deletion
-    return -1;
+int storage_insert_records(ObeliskStorage* storage, const char* table_name, const ObeliskRecord* records,
+                           size_t n, uint64_t* record_ids) {
+    if (!storage || !table_name || (n > 0 && !records)) return -1;
+
+    // Every record is checked before any is stored, and the batch buffer
+    // is sized to what they need
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!record_fits(storage, &records[i])) return -1;
+        bytes += RECORD_PREFIX + records[i].size + sizeof(SlotEntry);
+    }
+    if (n == 0) return 0;
+
+    CatalogTable* table = open_table(storage, table_name);
+    if (!table) return -1;
+
+    size_t capacity = bytes / (storage->page_size - sizeof(SlottedPageHeader)) + 2;
+    if (capacity > LOADER_BATCH_PAGES) capacity = LOADER_BATCH_PAGES;
+    char* pages = malloc(capacity * storage->page_size);
+    if (!pages) return -1;
+
+    ObeliskTableLoader loader;
+    loader_init(&loader, storage, table, pages, capacity);
+    int rc = 0;
+    for (size_t i = 0; i < n && rc == 0; i++) {
+        rc = loader_add(&loader, &records[i], record_ids ? &record_ids[i] : NULL);
+    }
+    if (rc == 0) rc = loader_flush(&loader);
+
+    free(pages);
+    return rc;
 }
 
-ObeliskRecord* storage_get_record(ObeliskStorage* storage, const char* table_name, uint64_t record_id) {
-    // TODO: Implement record retrieval
-    return NULL;
+ObeliskTableLoader* storage_loader_begin(ObeliskStorage* storage, const char* table_name) {
+    if (!storage || !table_name) return NULL;
+
+    CatalogTable* table = open_table(storage, table_name);
+    if (!table) return NULL;
+
+    ObeliskTableLoader* loader = malloc(sizeof(ObeliskTableLoader));
+    char* pages = malloc(LOADER_BATCH_PAGES * storage->page_size);
+    if (!loader || !pages) {
+        free(loader);
+        free(pages);
+        return NULL;
+    }
+
+    loader_init(loader, storage, table, pages, LOADER_BATCH_PAGES);
+    return loader;
+}
+
+int storage_loader_append(ObeliskTableLoader* loader, const ObeliskRecord* record, uint64_t* record_id) {
+    if (!loader || !record || !record_fits(loader->storage, record)) return -1;
+    return loader_add(loader, record, record_id);
+}
+
+int storage_loader_finish(ObeliskTableLoader* loader) {
+    if (!loader) return -1;
+
+    int rc = loader_flush(loader);
+    free(loader->pages);
+    free(loader);
+    return rc;
 }
 
 void* storage_allocate_page(ObeliskStorage* storage) {
@@ -252,18 +704,18 @@ void* storage_allocate_page(ObeliskStorage* storage) {
 }
 
 int storage_free_page(ObeliskStorage* storage, uint64_t page_id) {
-    // TODO: Implement page deallocation
-    return -1;
+    if (!storage) return -1;
+    return page_store_free(&storage->pages, page_id);
 }
 
 int storage_write_page(ObeliskStorage* storage, uint64_t page_id, const void* data) {
-    // TODO: Implement page writing
-    return -1;
+    if (!storage || !data) return -1;
+    return page_store_write(&storage->pages, page_id, data);
 }
 
 int storage_read_page(ObeliskStorage* storage, uint64_t page_id, void* data) {
-    // TODO: Implement page reading
-    return -1;
+    if (!storage || !data) return -1;
+    return page_store_read(&storage->pages, page_id, data);
 }
 
 int storage_vacuum(ObeliskStorage* storage, const char* table_name) {
@@ -276,9 +728,23 @@ int storage_analyze(ObeliskStorage* storage, const char* table_name) {
     return -1;
 }
 
+// Make a table's pages durable, then its metadata, marked clean
+static int checkpoint_table(CatalogTable* table, void* ctx) {
+    (void)ctx;
+    if (!table->meta_dirty) return 0;
+    if (fdatasync(table->fd) != 0) return -1;
+
+    table->meta.flags |= TABLE_META_CLEAN;
+    if (write_meta(table) != 0 || fdatasync(table->fd) != 0) return -1;
+    table->meta_dirty = false;
+    return 0;
+}
+
 int storage_checkpoint(ObeliskStorage* storage) {
-    // TODO: Implement checkpointing
-    return -1;
+    if (!storage) return -1;
+    int rc = catalog_for_each(&storage->catalog, checkpoint_table, NULL);
+    if (page_store_checkpoint(&storage->pages) != 0) rc = -1;
+    return rc == 0 ? 0 : -1;
 }
 
 ObeliskStorageStats storage_get_stats(ObeliskStorage* storage) {